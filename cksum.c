@@ -60,16 +60,48 @@ static const unsigned long crctab[] = {         0x00000000,
 0xa2f33668, 0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
 };
 
+/* crctab[c] extended by k zero bytes, to do 8 bytes per step */
+static uint32_t slice[8][256];
+
+static void
+mkslice(void)
+{
+	int i, k;
+
+	for (i = 0; i < 256; i++)
+		slice[0][i] = crctab[i];
+	for (k = 1; k < 8; k++)
+		for (i = 0; i < 256; i++)
+			slice[k][i] = (slice[k - 1][i] << 8) ^
+			              crctab[slice[k - 1][i] >> 24];
+}
+
+static uint32_t
+crc(uint32_t ck, const unsigned char *p, size_t n)
+{
+	for (; n >= 8; n -= 8, p += 8) {
+		ck ^= (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+		      (uint32_t)p[2] << 8 | p[3];
+		ck = slice[7][ck >> 24] ^ slice[6][(ck >> 16) & 0xFF] ^
+		     slice[5][(ck >> 8) & 0xFF] ^ slice[4][ck & 0xFF] ^
+		     slice[3][p[4]] ^ slice[2][p[5]] ^
+		     slice[1][p[6]] ^ slice[0][p[7]];
+	}
+	for (; n; n--, p++)
+		ck = (ck << 8) ^ slice[0][(ck >> 24) ^ *p];
+	return ck;
+}
+
 static void
 cksum(FILE *fp, const char *s)
 {
-	size_t len = 0, i, n;
+	static unsigned char buf[1 << 17];
+	uintmax_t len = 0, i;
+	size_t n;
 	uint32_t ck = 0;
-	unsigned char buf[BUFSIZ];
 
 	while ((n = fread(buf, 1, sizeof(buf), fp))) {
-		for (i = 0; i < n; i++)
-			ck = (ck << 8) ^ crctab[(ck >> 24) ^ buf[i]];
+		ck = crc(ck, buf, n);
 		len += n;
 	}
 	if (ferror(fp)) {
@@ -81,7 +113,7 @@ cksum(FILE *fp, const char *s)
 	for (i = len; i; i >>= 8)
 		ck = (ck << 8) ^ crctab[(ck >> 24) ^ (i & 0xFF)];
 
-	printf("%"PRIu32" %zu", ~ck, len);
+	printf("%"PRIu32" %"PRIuMAX, ~ck, len);
 	if (s) {
 		putchar(' ');
 		fputs(s, stdout);
@@ -95,6 +127,7 @@ main(int argc, char *argv[])
 	FILE *fp;
 
 	argv0 = argv[0], argc--, argv++;
+	mkslice();
 
 	if (!argc) {
 		cksum(stdin, NULL);
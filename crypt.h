@@ -6,6 +6,9 @@ struct crypt_ops {
 	void *s;
 };
 
+extern int crypt_jobs;
+extern int crypt_failfast;
+
 int cryptcheck(int, char **, struct crypt_ops *, uint8_t *, size_t);
 int cryptmain(int, char **, struct crypt_ops *, uint8_t *, size_t);
 int cryptsum(struct crypt_ops *, FILE *, const char *, uint8_t *);
@@ -0,0 +1,56 @@
+/* See LICENSE file for copyright and license details. */
+
+/* gzip (rfc1952) streams of deflate (rfc1951) data */
+
+struct deflate {
+	uint8_t *buf;     /* window of history, then the bytes to compress */
+	size_t len;       /* bytes in buf */
+	size_t start;     /* where the bytes to compress begin */
+	uint32_t *head;   /* hash chains, 1 + position or 0 */
+	uint32_t *prev;
+	uint16_t *tlen;   /* literal or match length of each token */
+	uint16_t *tdist;  /* 0 for literals */
+	uint32_t crc;
+	uint32_t isize;
+	uint32_t bits;    /* bits not yet written to out */
+	int nbits;
+	uint8_t *out;     /* compressed data, taken by the caller */
+	size_t outlen;
+	size_t outsiz;
+};
+
+struct inflate {
+	int fd;           /* compressed data is read from fd */
+	uint8_t *in;
+	size_t inoff;
+	size_t inlen;
+	uint32_t bits;    /* bits read from in but not used */
+	int nbits;
+	uint8_t *win;     /* window of decompressed data */
+	size_t wpos;
+	size_t avail;     /* bytes before wpos not yet returned */
+	size_t have;      /* bytes of history a match may refer to */
+	int state;
+	int last;
+	int members;
+	size_t stored;    /* bytes left in a stored block */
+	uint16_t lcount[16], lsym[288], ltab[512];
+	uint16_t dcount[16], dsym[30], dtab[512];
+	uint32_t crc;
+	uint32_t isize;
+};
+
+/* start a gzip stream, the header is put in out */
+void deflate_init(struct deflate *d);
+/* compress len bytes of m, appending any output to out */
+void deflate_update(struct deflate *d, const void *m, size_t len);
+/* compress what is left and put the trailer in out */
+void deflate_finish(struct deflate *d);
+
+/* start reading a gzip stream from fd */
+void inflate_init(struct inflate *z, int fd);
+/* read up to n bytes of decompressed data, less only at the end */
+size_t inflate_read(struct inflate *z, void *buf, size_t n);
+
+/* crc-32 as used by gzip, start with 0 */
+uint32_t crc32(uint32_t crc, const void *m, size_t len);
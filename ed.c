@@ -1,6 +1,5 @@
 /* See LICENSE file for copyright and license details. */
 #include <sys/stat.h>
-#include <fcntl.h>
 #include <regex.h>
 #include <unistd.h>
 
@@ -18,16 +17,24 @@
 #define REGEXSIZE  100
 #define LINESIZE    80
 #define NUMLINES    32
-#define CACHESIZ  4096
+#define BLOCKSIZ 65536
 
 struct hline {
-	off_t seek;
+	char *txt;
 	char  global;
 	int   next, prev;
 };
 
+/* line text is kept in blocks that are never moved or freed until the
+ * buffer is cleared, so pointers to it stay valid */
+struct block {
+	struct block *prev;
+	size_t siz, used;
+	char buf[];
+};
+
 struct undo {
-	int curln;
+	int curln, lastln;
 	size_t nr, cap;
 	struct link {
 		int to1, from1;
@@ -41,20 +48,18 @@ static regmatch_t matchs[10];
 static char *lastre;
 
 static int optverbose, optprompt, exstatus, optdiag = 1;
-static int marks['z' - 'a'];
+static int marks['z' - 'a' + 1];
 static int nlines, line1, line2;
-static int curln, lastln, ocurln;
+static int curln, lastln, ocurln, olastln;
 static jmp_buf savesp;
 static char *lasterr;
 static size_t idxsize, lastidx;
 static struct hline *zero;
-static char *text;
+static int *lineidx;
+static size_t lineidxsiz, nvalid;
+static struct block *blocks;
 static char savfname[FILENAME_MAX];
-static char tmpname[FILENAME_MAX];
-static size_t sizetxt, memtxt;
-static int scratch;
 static int pflag, modflag, uflag, gflag;
-static size_t csize;
 static char *cmdline;
 static char *ocmdline;
 static size_t cmdsiz, cmdcap;
@@ -152,6 +157,31 @@ back(int c)
 	return c;
 }
 
+static char *
+store(char *s, size_t len)
+{
+	struct block *bp = blocks;
+	size_t siz;
+	char *p;
+
+	if (!bp || bp->siz - bp->used <= len) {
+		siz = (len >= BLOCKSIZ) ? len + 1 : BLOCKSIZ;
+		if (siz > SIZE_MAX - sizeof(*bp) ||
+		    !(bp = malloc(sizeof(*bp) + siz)))
+			error("out of memory");
+		bp->prev = blocks;
+		bp->siz = siz;
+		bp->used = 0;
+		blocks = bp;
+	}
+	p = bp->buf + bp->used;
+	memcpy(p, s, len);
+	p[len] = '\0';
+	bp->used += len + 1;
+
+	return p;
+}
+
 static int
 makeline(char *s, int *off)
 {
@@ -169,16 +199,13 @@ makeline(char *s, int *off)
 	lp = zero + lastidx;
 
 	if (!s) {
-		lp->seek = -1;
+		lp->txt = NULL;
 		len = 0;
 	} else {
 		while ((c = *s++) != '\n')
 			/* nothing */;
 		len = s - begin;
-		if ((lp->seek = lseek(scratch, 0, SEEK_END)) < 0 ||
-		    write(scratch, begin, len) < 0) {
-			error("input/output error");
-		}
+		lp->txt = store(begin, len);
 	}
 	if (off)
 		*off = len;
@@ -186,55 +213,48 @@ makeline(char *s, int *off)
 	return lp - zero;
 }
 
+/*
+ * lineidx[n] caches the index of line n for n < nvalid, so walking
+ * the list only has to start at the first line changed since the last
+ * lookup instead of at zero
+ */
 static int
 getindex(int line)
 {
-	struct hline *lp;
-	int n;
+	size_t n = line;
+	int *p;
 
-	for (n = 0, lp = zero; n != line; ++n)
-		lp = zero + lp->next;
+	if (n >= lineidxsiz) {
+		if (n > SIZE_MAX / 2 / sizeof(*p) ||
+		    !(p = realloc(lineidx, 2 * n * sizeof(*p) + sizeof(*p))))
+			error("out of memory");
+		lineidxsiz = 2 * n + 1;
+		lineidx = p;
+	}
+	if (nvalid == 0) {
+		lineidx[0] = 0;
+		nvalid = 1;
+	}
+	for (; nvalid <= n; ++nvalid)
+		lineidx[nvalid] = zero[lineidx[nvalid-1]].next;
 
-	return lp - zero;
+	return lineidx[n];
+}
+
+static void
+invalidate(int line)
+{
+	if (nvalid > (size_t) line)
+		nvalid = line;
 }
 
 static char *
 gettxt(int line)
 {
-	static char buf[CACHESIZ];
-	static off_t lasto;
 	struct hline *lp;
-	off_t off, block;
-	ssize_t n;
-	char *p;
 
 	lp = zero + getindex(line);
-	sizetxt = 0;
-	off = lp->seek;
-
-	if (off == (off_t) -1)
-		return text = addchar('\0', text, &memtxt, &sizetxt);
-
-repeat:
-	if (!csize || off < lasto || off - lasto >= csize) {
-		block = off & ~(CACHESIZ-1);
-		if (lseek(scratch, block, SEEK_SET) < 0 ||
-		    (n = read(scratch, buf, CACHESIZ)) < 0) {
-			error("input/output error");
-		}
-		csize = n;
-		lasto = block;
-	}
-	for (p = buf + off - lasto; p < buf + csize && *p != '\n'; ++p) {
-		++off;
-		text = addchar(*p, text, &memtxt, &sizetxt);
-	}
-	if (csize && p == buf + csize)
-		goto repeat;
-
-	text = addchar('\n', text, &memtxt, &sizetxt);
-	text = addchar('\0', text, &memtxt, &sizetxt);
-	return text;
+	return lp->txt ? lp->txt : "";
 }
 
 static void
@@ -260,6 +280,7 @@ relink(int to1, int from1, int from2, int to2)
 	if (newcmd) {
 		clearundo();
 		udata.curln = ocurln;
+		udata.lastln = olastln;
 	}
 	if (udata.nr >= udata.cap) {
 		size_t siz = (udata.cap + 10) * sizeof(struct link);
@@ -294,6 +315,8 @@ undo(void)
 	udata.vec = NULL;
 	udata.cap = 0;
 	curln = udata.curln;
+	lastln = udata.lastln;
+	invalidate(0);
 }
 
 static void
@@ -303,6 +326,7 @@ inject(char *s)
 
 	begin = getindex(curln);
 	end = getindex(nextln(curln));
+	invalidate(curln + 1);
 
 	while (*s) {
 		k = makeline(s, &off);
@@ -318,31 +342,26 @@ inject(char *s)
 static void
 clearbuf()
 {
-	if (scratch)
-		close(scratch);
-	remove(tmpname);
+	struct block *bp;
+
+	while ((bp = blocks)) {
+		blocks = bp->prev;
+		free(bp);
+	}
 	free(zero);
 	zero = NULL;
-	scratch = csize = idxsize = lastidx = curln = lastln = 0;
+	invalidate(0);
+	idxsize = lastidx = curln = lastln = 0;
 	modflag = lastln = curln = 0;
 }
 
 static void
 setscratch()
 {
-	int r, k;
-	char *dir;
+	int k;
 
 	clearbuf();
 	clearundo();
-	if ((dir = getenv("TMPDIR")) == NULL)
-		dir = "/tmp";
-	r = snprintf(tmpname, sizeof(tmpname), "%s/%s",
-	             dir, "ed.XXXXXX");
-	if (r < 0 || (size_t)r >= sizeof(tmpname))
-		error("scratch filename too long");
-	if ((scratch = mkstemp(tmpname)) < 0)
-		error("failed to create scratch file");
 	if ((k = makeline(NULL, NULL)))
 		error("input/output error in scratch file");
 	relink(k, k, k, k);
@@ -478,9 +497,9 @@ linenum(int *line)
 		break;
 	case '\'':
 		skipblank();
-		if (!isalpha(c = input()))
+		if (!islower(c = input()))
 			error("invalid mark character");
-		if (!(ln = marks[c]))
+		if (!(ln = marks[c - 'a']))
 			error("invalid address");
 		break;
 	case '$':
@@ -656,9 +675,13 @@ doprint(void)
 	for (i = line1; i <= line2; ++i) {
 		if (pflag == 'n')
 			printf("%d\t", i);
+		if (pflag != 'l') {
+			for (s = str = gettxt(i); *s != '\n'; ++s)
+				/* nothing */;
+			fwrite(str, 1, s - str + 1, stdout);
+			continue;
+		}
 		for (s = gettxt(i); (c = *s) != '\n'; ++s) {
-			if (pflag != 'l')
-				goto print_char;
 			switch (c) {
 			case '$':
 				str = "\\$";
@@ -677,7 +700,6 @@ doprint(void)
 					printf("\\x%x", 0xFF & c);
 					break;
 				}
-			print_char:
 				putchar(c);
 				break;
 			print_str:
@@ -685,9 +707,7 @@ doprint(void)
 				break;
 			}
 		}
-		if (pflag == 'l')
-			fputs("$", stdout);
-		putc('\n', stdout);
+		fputs("$\n", stdout);
 	}
 	curln = i - 1;
 }
@@ -769,6 +789,7 @@ delete(int from, int to)
 	lastln -= to - from + 1;
 	curln = (from > lastln) ? lastln : from;;
 	relink(lto, lfrom, lto, lfrom);
+	invalidate(from);
 }
 
 static void
@@ -784,17 +805,19 @@ move(int where)
 	lfrom = getindex(line1);
 	lto = getindex(line2);
 	relink(after, before, after, before);
+	invalidate(line1);
 
 	if (where < line1) {
-		curln = where + line1 - line2 + 1;
+		curln = where + line2 - line1 + 1;
 	} else {
 		curln = where;
-		where -= line1 - line2 + 1;
+		where -= line2 - line1 + 1;
 	}
 	before = getindex(where);
 	after = getindex(nextln(where));
 	relink(lfrom, before, lfrom, before);
 	relink(after, lto, after, lto);
+	invalidate(where + 1);
 }
 
 static void
@@ -1191,7 +1214,7 @@ repeat:
 			error("invalid mark character");
 		chkprint(1);
 		deflines(curln, curln);
-		marks[c] = line1;
+		marks[c - 'a'] = line1;
 		break;
 	case 'P':
 		if (nlines > 0)
@@ -1368,6 +1391,7 @@ edit(void)
 	for (;;) {
 		newcmd = 1;
 		ocurln = curln;
+		olastln = lastln;
 		cmdsiz = 0;
 		repidx = -1;
 		if (optprompt)
@@ -1,18 +1,24 @@
 /* See LICENSE file for copyright and license details. */
+#include <ctype.h>
 #include <regex.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 
+#include "fs.h"
 #include "queue.h"
 #include "util.h"
 
 enum { Match = 0, NoMatch = 1, Error = 2 };
 
 static void addpattern(const char *, size_t);
+static char *getliteral(const char *, size_t *);
 static void addpatternfile(FILE *);
+static int matchline(const char *, size_t);
 static int grep(FILE *, const char *);
+static int grepblock(FILE *, const char *);
+static void grepr(const char *, struct stat *, void *, struct recursor *);
 
 static int Eflag;
 static int Fflag;
@@ -21,6 +27,7 @@ static int eflag;
 static int fflag;
 static int hflag;
 static int iflag;
+static int rflag;
 static int sflag;
 static int vflag;
 static int wflag;
@@ -28,14 +35,117 @@ static int xflag;
 static int many;
 static int mode;
 
+static unsigned char fold[256];
+
 struct pattern {
 	char *pattern;
+	char *lit;
+	size_t litlen;
+	size_t *skip;
+	int indfa;
 	regex_t preg;
 	SLIST_ENTRY(pattern) entry;
 };
 
 static SLIST_HEAD(phead, pattern) phead;
 
+/*
+ * Return the longest literal string every line matching the pattern
+ * must contain, or NULL if there is none.  The pattern is scanned so
+ * that the result holds for both BREs and EREs, as -E may still follow.
+ * Only literals outside of groups are taken into account; anything
+ * that cannot be proven mandatory ends the current run.
+ */
+static char *
+getliteral(const char *pattern, size_t *litlen)
+{
+	const char *p;
+	char *run, *best;
+	size_t len = 0, bestlen = 0;
+	int depth[2] = { 0, 0 }, esc;
+
+	if (strchr(pattern, '|'))
+		return NULL; /* alternation */
+
+	run = enmalloc(Error, strlen(pattern) + 1);
+	best = enmalloc(Error, strlen(pattern) + 1);
+
+	for (p = pattern; *p; p++) {
+		if (*p == '\\' && p[1] && strchr(".[]\\*^$/", p[1])) {
+			/* escaped literal character */
+			p++;
+			if (!depth[0] && !depth[1])
+				run[len++] = *p;
+			continue;
+		}
+		if ((esc = (*p == '\\' && p[1])))
+			p++;
+		switch (*p) {
+		/* BREs group with escaped, EREs with plain parentheses */
+		case '(':
+			depth[esc]++;
+			break;
+		case ')':
+			depth[esc]--;
+			break;
+		case '{':
+			/* interval expression */
+			p += strspn(p + 1, "0123456789,");
+			if (p[1] == '\\' && p[2] == '}')
+				p += 2;
+			else if (p[1] == '}')
+				p++;
+			/* fallthrough */
+		case '*':
+		case '+':
+		case '?':
+			/* the preceding character is optional, drop all of it */
+			while (len && !UTF8_POINT(run[len - 1]))
+				len--;
+			if (len)
+				len--;
+			break;
+		case '[':
+			/* skip the bracket expression */
+			p++;
+			if (*p == '^')
+				p++;
+			if (*p == ']')
+				p++;
+			for (; *p && *p != ']'; p++)
+				if (*p == '[' && p[1] && strchr(":=.", p[1]))
+					if (!(p = strchr(p + 2, p[1])) || !*++p)
+						goto done;
+			if (!*p)
+				goto done;
+			break;
+		default:
+			if (!esc && !strchr(".^$", *p)) {
+				if (!depth[0] && !depth[1])
+					run[len++] = *p;
+				continue;
+			}
+			/* anchor, wildcard, back-reference or class */
+			break;
+		}
+		if (len > bestlen)
+			memcpy(best, run, (bestlen = len));
+		len = 0;
+	}
+done:
+	if (len > bestlen)
+		memcpy(best, run, (bestlen = len));
+	free(run);
+	if (!bestlen) {
+		free(best);
+		return NULL;
+	}
+	best[bestlen] = '\0';
+	*litlen = bestlen;
+
+	return best;
+}
+
 static void
 addpattern(const char *pattern, size_t patlen)
 {
@@ -80,6 +190,7 @@ addpattern(const char *pattern, size_t patlen)
 
 	pnode = enmalloc(Error, sizeof(*pnode));
 	pnode->pattern = tmp;
+	pnode->lit = Fflag ? NULL : getliteral(pattern, &pnode->litlen);
 	SLIST_INSERT_HEAD(&phead, pnode, entry);
 }
 
@@ -99,62 +210,867 @@ addpatternfile(FILE *fp)
 		enprintf(Error, "read error:");
 }
 
+/*
+ * Patterns free of back-references and word anchors are compiled
+ * into a single Thompson NFA, which is turned into a DFA lazily while
+ * matching.  DFA states are cached until there are DFAMAX of them, at
+ * which point the cache is flushed.  If that happens too often the
+ * automaton is given up on in favour of regexec(3).  grep does not set
+ * the locale, so the automaton works on bytes just like regexec(3) in
+ * the C locale.
+ */
+#define DFAMAX   512
+#define DFAHASH  1021
+#define NFAMAX   32768
+#define REPMAX   255
+
+enum { NChar, NSplit, NEps, NBol, NEol, NMatch };
+
+struct nnode {
+	int type;
+	int out, out1;
+	unsigned char set[32];
+};
+
+struct frag {
+	int lo, start, end;
+};
+
+struct dstate {
+	int *set;
+	size_t n;
+	int bol;
+	int accept;
+	int accepteol;
+	struct dstate *next[256];
+	struct dstate *hnext;
+	struct dstate *link;
+};
+
+static struct nnode *nfa;
+static size_t nfalen, nfacap;
+static struct frag nfaall;
+static int nfastart = -1;
+static unsigned *nfamark, nfagen;
+static int *nfastack, *nfatmp, *nfaset;
+
+static struct dstate *dhash[DFAHASH];
+static struct dstate *dstates, *dinit;
+static size_t ndstates, dflushes, dslow, dscanned;
+
+static const char *rp;
+static int rerr, rdepth;
+
+#define SETBIT(s, c)  ((s)[(unsigned char)(c) >> 3] |= 1 << ((unsigned char)(c) & 7))
+#define ISSET(s, c)   ((s)[(unsigned char)(c) >> 3] & (1 << ((unsigned char)(c) & 7)))
+
+static int
+newnode(int type, int out, int out1)
+{
+	if (nfalen >= NFAMAX) {
+		rerr = 1;
+		return 0;
+	}
+	if (nfalen == nfacap) {
+		nfacap = nfacap ? nfacap * 2 : 64;
+		nfa = enrealloc(Error, nfa, nfacap * sizeof(*nfa));
+	}
+	memset(&nfa[nfalen], 0, sizeof(*nfa));
+	nfa[nfalen].type = type;
+	nfa[nfalen].out = out;
+	nfa[nfalen].out1 = out1;
+
+	return nfalen++;
+}
+
+static struct frag
+fragnode(int type)
+{
+	struct frag f;
+
+	f.lo = f.start = f.end = newnode(type, -1, -1);
+
+	return f;
+}
+
+static struct frag
+fragset(const unsigned char *set)
+{
+	struct frag f;
+
+	f.lo = f.start = newnode(NChar, -1, -1);
+	f.end = newnode(NEps, -1, -1);
+	if (!rerr) {
+		memcpy(nfa[f.start].set, set, sizeof(nfa[f.start].set));
+		nfa[f.start].out = f.end;
+	}
+
+	return f;
+}
+
+static struct frag
+fragchar(int c)
+{
+	unsigned char set[32] = { 0 };
+
+	SETBIT(set, c);
+	if (iflag) {
+		SETBIT(set, tolower(c));
+		SETBIT(set, toupper(c));
+	}
+
+	return fragset(set);
+}
+
+static struct frag
+cat(struct frag a, struct frag b)
+{
+	if (!rerr)
+		nfa[a.end].out = b.start;
+	a.end = b.end;
+
+	return a;
+}
+
+static struct frag
+alt(struct frag a, struct frag b)
+{
+	int s, e;
+
+	s = newnode(NSplit, a.start, b.start);
+	e = newnode(NEps, -1, -1);
+	if (!rerr)
+		nfa[a.end].out = nfa[b.end].out = e;
+	a.start = s;
+	a.end = e;
+
+	return a;
+}
+
+static struct frag
+repeat(struct frag a, int type)
+{
+	int s, e;
+
+	/* type is one of '*', '+' and '?' */
+	s = newnode(NSplit, a.start, -1);
+	e = newnode(NEps, -1, -1);
+	if (rerr)
+		return a;
+	nfa[s].out1 = e;
+	nfa[a.end].out = (type == '?') ? e : s;
+	if (type != '+')
+		a.start = s;
+	a.end = e;
+
+	return a;
+}
+
+static struct frag
+dupfrag(struct frag a)
+{
+	struct frag f;
+	int i, off;
+
+	off = nfalen - a.lo;
+	for (i = a.lo; i <= a.end && !rerr; i++) {
+		newnode(nfa[i].type, -1, -1);
+		if (rerr)
+			break;
+		nfa[i + off] = nfa[i];
+		if (nfa[i].out >= 0)
+			nfa[i + off].out += off;
+		if (nfa[i].out1 >= 0)
+			nfa[i + off].out1 += off;
+	}
+	f.lo = a.lo + off;
+	f.start = a.start + off;
+	f.end = a.end + off;
+
+	return f;
+}
+
+static struct frag
+interval(struct frag a, int min, int max)
+{
+	struct frag f, g, c[REPMAX];
+	int i, n;
+
+	/* max < 0 stands for no upper bound */
+	n = (max < 0) ? MAX(min, 1) : max;
+	if (!n)
+		return fragnode(NEps);
+	c[0] = a;
+	for (i = 1; i < n; i++)
+		c[i] = dupfrag(a);
+	if (max < 0 && !min)
+		return repeat(c[0], '*');
+	for (i = 0; i < n; i++) {
+		if (i >= min)
+			g = repeat(c[i], '?');
+		else if (max < 0 && i == n - 1)
+			g = repeat(c[i], '+');
+		else
+			g = c[i];
+		f = i ? cat(f, g) : g;
+	}
+
+	return f;
+}
+
+static void
+parsebracket(unsigned char *set)
+{
+	static const struct {
+		const char *name;
+		int (*fn)(int);
+	} classes[] = {
+		{ "alnum",  isalnum  }, { "alpha",  isalpha  },
+		{ "blank",  isblank  }, { "cntrl",  iscntrl  },
+		{ "digit",  isdigit  }, { "graph",  isgraph  },
+		{ "lower",  islower  }, { "print",  isprint  },
+		{ "punct",  ispunct  }, { "space",  isspace  },
+		{ "upper",  isupper  }, { "xdigit", isxdigit },
+	};
+	unsigned char pos[32] = { 0 };
+	const char *end;
+	size_t i;
+	int c, d, neg = 0, first;
+
+	if (*++rp == '^') {
+		neg = 1;
+		rp++;
+	}
+	for (first = 1; *rp && (first || *rp != ']'); first = 0) {
+		if (rp[0] == '[' && rp[1] == ':') {
+			if (!(end = strstr(rp + 2, ":]")))
+				goto err;
+			for (i = 0; i < LEN(classes); i++)
+				if (strlen(classes[i].name) == (size_t)(end - rp - 2) &&
+				    !strncmp(classes[i].name, rp + 2, end - rp - 2))
+					break;
+			/* REG_ICASE treats case classes specially */
+			if (i == LEN(classes) || (iflag && (classes[i].fn == islower ||
+			                                    classes[i].fn == isupper)))
+				goto err;
+			for (c = 1; c < 256; c++)
+				if (classes[i].fn(c))
+					SETBIT(pos, c);
+			rp = end + 2;
+		} else if (rp[0] == '[' && (rp[1] == '=' || rp[1] == '.')) {
+			/* single character equivalence class or collating symbol */
+			if (!rp[2] || rp[3] != rp[1] || rp[4] != ']')
+				goto err;
+			SETBIT(pos, rp[2]);
+			rp += 5;
+			if (rp[0] == '-' && rp[1] != ']')
+				goto err;
+		} else {
+			c = (unsigned char)*rp++;
+			if (rp[0] == '-' && rp[1] && rp[1] != ']') {
+				d = (unsigned char)rp[1];
+				if (d == '[' || c > d || iflag)
+					goto err;
+				for (; c <= d; c++)
+					SETBIT(pos, c);
+				rp += 2;
+			} else {
+				SETBIT(pos, c);
+			}
+		}
+	}
+	if (*rp != ']')
+		goto err;
+	rp++;
+
+	if (iflag)
+		for (c = 1; c < 256; c++)
+			if (ISSET(pos, c)) {
+				SETBIT(pos, tolower(c));
+				SETBIT(pos, toupper(c));
+			}
+	for (c = 1; c < 256; c++)
+		if (!ISSET(pos, c) != !neg)
+			SETBIT(set, c);
+	return;
+err:
+	rerr = 1;
+}
+
+static struct frag parsealt(void);
+
+static int
+isquant(void)
+{
+	if (Eflag)
+		return *rp && strchr("*+?{", *rp);
+	return *rp == '*' || (rp[0] == '\\' && rp[1] == '{');
+}
+
+/*
+ * start is 0 at the beginning of a branch, 1 right after a leading
+ * '^' and 2 otherwise; BREs give '^' and '*' special meaning there.
+ */
+static struct frag
+parserep(int start)
+{
+	unsigned char set[32] = { 0 };
+	struct frag f;
+	int c, min, max;
+
+	c = (unsigned char)*rp;
+	if (Eflag && c == '(') {
+		rp++;
+		rdepth++;
+		f = parsealt();
+		if (*rp != ')')
+			rerr = 1;
+		rp += !!*rp;
+		rdepth--;
+	} else if (!Eflag && c == '\\' && rp[1] == '(') {
+		rp += 2;
+		rdepth++;
+		f = parsealt();
+		if (rp[0] != '\\' || rp[1] != ')')
+			rerr = 1;
+		rp += 2 * !rerr;
+		rdepth--;
+	} else if (c == '^' && (Eflag || !start)) {
+		rp++;
+		f = fragnode(NBol);
+		if (Eflag && isquant())
+			rerr = 1;
+		return f;
+	} else if (c == '$' && (Eflag || !rp[1] || (rp[1] == '\\' && rp[2] == ')'))) {
+		rp++;
+		f = fragnode(NEol);
+		if (Eflag && isquant())
+			rerr = 1;
+		return f;
+	} else if (c == '.') {
+		rp++;
+		memset(set, 0xff, sizeof(set));
+		set[0] &= ~1;
+		f = fragset(set);
+	} else if (c == '[') {
+		parsebracket(set);
+		f = fragset(set);
+	} else if (c == '\\') {
+		/* back-references, word anchors and GNU operators are left to regexec */
+		c = (unsigned char)rp[1];
+		if (!c || isalnum(c) || strchr("<>`'", c) ||
+		    (!Eflag && strchr("(){}|+?", c))) {
+			rerr = 1;
+			return fragnode(NEps);
+		}
+		rp += 2;
+		f = fragchar(c);
+	} else if (c == '*' && !Eflag && start < 2) {
+		rp++;
+		f = fragchar(c);
+	} else if (Eflag && strchr("*+?{", c)) {
+		rerr = 1;
+		return fragnode(NEps);
+	} else {
+		rp++;
+		f = fragchar(c);
+	}
+
+	while (!rerr && isquant()) {
+		c = *rp;
+		rp += (c == '\\') ? 2 : 1;
+		if (c == '*' || c == '+' || c == '?') {
+			f = repeat(f, c);
+			continue;
+		}
+		/* interval expression */
+		if (!isdigit((unsigned char)*rp)) {
+			rerr = 1;
+			break;
+		}
+		min = max = strtol(rp, (char **)&rp, 10);
+		if (*rp == ',') {
+			rp++;
+			max = isdigit((unsigned char)*rp) ? strtol(rp, (char **)&rp, 10) : -1;
+		}
+		if (!Eflag && *rp == '\\')
+			rp++;
+		if (*rp != '}' || min > REPMAX || max > REPMAX || (max >= 0 && min > max)) {
+			rerr = 1;
+			break;
+		}
+		rp++;
+		f = interval(f, min, max);
+	}
+
+	return f;
+}
+
+static struct frag
+parsecat(void)
+{
+	struct frag f, g;
+	int start = 0;
+
+	f = fragnode(NEps);
+	while (*rp && !rerr) {
+		if (Eflag && (*rp == '|' || *rp == ')')) {
+			if (*rp == ')' && !rdepth)
+				rerr = 1;
+			break;
+		}
+		if (!Eflag && rp[0] == '\\' && rp[1] == ')') {
+			if (!rdepth)
+				rerr = 1;
+			break;
+		}
+		g = parserep(start);
+		if (rerr)
+			break;
+		start = (!start && nfa[g.start].type == NBol) ? 1 : 2;
+		f = cat(f, g);
+	}
+
+	return f;
+}
+
+static struct frag
+parsealt(void)
+{
+	struct frag f;
+
+	f = parsecat();
+	while (!rerr && Eflag && *rp == '|') {
+		rp++;
+		f = alt(f, parsecat());
+	}
+
+	return f;
+}
+
+/* add pattern to the automaton, return 0 if it is not supported */
+static int
+dfaadd(const char *pattern)
+{
+	struct frag f;
+	size_t len = nfalen;
+
+	rp = pattern;
+	rerr = rdepth = 0;
+	f = parsealt();
+	if (!rerr && *rp)
+		rerr = 1;
+	if (!rerr && nfastart >= 0)
+		f = alt(nfaall, f);
+	/* keep room for the match node */
+	if (rerr || nfalen >= NFAMAX) {
+		nfalen = len;
+		return 0;
+	}
+	nfaall = f;
+	nfastart = f.start;
+
+	return 1;
+}
+
+static int
+intcmp(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+static size_t
+closure(const int *in, size_t nin, int bol, int withstart, int *out)
+{
+	size_t sp = 0, n = 0;
+	int i;
+
+	nfagen++;
+	while (nin)
+		nfastack[sp++] = in[--nin];
+	if (withstart)
+		nfastack[sp++] = nfastart;
+	while (sp) {
+		i = nfastack[--sp];
+		if (i < 0 || nfamark[i] == nfagen)
+			continue;
+		nfamark[i] = nfagen;
+		switch (nfa[i].type) {
+		case NSplit:
+			nfastack[sp++] = nfa[i].out1;
+			/* fallthrough */
+		case NEps:
+			nfastack[sp++] = nfa[i].out;
+			break;
+		case NBol:
+			if (bol)
+				nfastack[sp++] = nfa[i].out;
+			break;
+		default:
+			out[n++] = i;
+			break;
+		}
+	}
+	qsort(out, n, sizeof(*out), intcmp);
+
+	return n;
+}
+
+/* whether the NFA set reaches a match when the end of line is hit */
+static int
+accepteol(const int *set, size_t n, int bol)
+{
+	size_t i, m;
+
+	for (i = m = 0; i < n; i++)
+		if (nfa[set[i]].type == NEol)
+			nfatmp[m++] = nfa[set[i]].out;
+	for (;;) {
+		m = closure(nfatmp, m, bol, 0, nfaset);
+		for (i = 0; i < m; i++)
+			if (nfa[nfaset[i]].type == NMatch)
+				return 1;
+		for (i = n = 0; i < m; i++)
+			if (nfa[nfaset[i]].type == NEol)
+				nfatmp[n++] = nfa[nfaset[i]].out;
+		if (!n)
+			return 0;
+		m = n;
+	}
+}
+
+static void
+dfaflush(void)
+{
+	struct dstate *d;
+
+	while ((d = dstates)) {
+		dstates = d->link;
+		free(d->set);
+		free(d);
+	}
+	memset(dhash, 0, sizeof(dhash));
+	/* flushing before the states paid off hints at a state explosion */
+	if (dscanned < DFAMAX * 64)
+		dslow++;
+	dscanned = 0;
+	ndstates = 0;
+	dinit = NULL;
+	dflushes++;
+}
+
+static struct dstate *
+getstate(const int *set, size_t n, int bol)
+{
+	struct dstate *d;
+	size_t i, h = bol;
+
+	for (i = 0; i < n; i++)
+		h = h * 31 + set[i];
+	h %= DFAHASH;
+	for (d = dhash[h]; d; d = d->hnext)
+		if (d->bol == bol && d->n == n && !memcmp(d->set, set, n * sizeof(*set)))
+			return d;
+
+	if (ndstates == DFAMAX)
+		dfaflush();
+	d = encalloc(Error, 1, sizeof(*d));
+	d->set = enmalloc(Error, MAX(n, 1) * sizeof(*set));
+	memcpy(d->set, set, n * sizeof(*set));
+	d->n = n;
+	d->bol = bol;
+	for (i = 0; i < n; i++)
+		if (nfa[set[i]].type == NMatch)
+			d->accept = 1;
+	d->accepteol = d->accept || accepteol(d->set, n, bol);
+	d->hnext = dhash[h];
+	dhash[h] = d;
+	d->link = dstates;
+	dstates = d;
+	ndstates++;
+
+	return d;
+}
+
+static struct dstate *
+dfastep(struct dstate *d, int c)
+{
+	struct dstate *nd;
+	size_t i, n = 0;
+
+	for (i = 0; i < d->n; i++)
+		if (nfa[d->set[i]].type == NChar && ISSET(nfa[d->set[i]].set, c))
+			nfatmp[n++] = nfa[d->set[i]].out;
+	n = closure(nfatmp, n, 0, 1, nfaset);
+	i = dflushes;
+	nd = getstate(nfaset, n, 0);
+	/* d is gone if the cache was flushed */
+	if (i == dflushes)
+		d->next[c] = nd;
+
+	return nd;
+}
+
+static int
+dfaexec(const char *s)
+{
+	struct dstate *d;
+	const char *p;
+	size_t n;
+	int c;
+
+	if (!dinit) {
+		n = closure(&nfastart, 1, 1, 0, nfaset);
+		dinit = getstate(nfaset, n, 1);
+	}
+	for (d = dinit, p = s; !d->accept && (c = (unsigned char)*p); p++)
+		d = d->next[c] ? d->next[c] : dfastep(d, c);
+	dscanned += p - s;
+
+	return d->accept || d->accepteol;
+}
+
+/* terminate the automaton once all patterns have been added */
+static void
+dfacomp(void)
+{
+	int m;
+
+	if (nfastart < 0)
+		return;
+	/* newnode() may move nfa */
+	m = newnode(NMatch, -1, -1);
+	nfa[nfaall.end].out = m;
+	nfamark = encalloc(Error, nfalen, sizeof(*nfamark));
+	nfastack = enmalloc(Error, (3 * nfalen + 1) * sizeof(*nfastack));
+	nfatmp = enmalloc(Error, nfalen * sizeof(*nfatmp));
+	nfaset = enmalloc(Error, nfalen * sizeof(*nfaset));
+}
+
+/* fold the literal of a pattern for -i and build its Horspool skip table */
+static void
+foldliteral(struct pattern *pnode)
+{
+	unsigned char *lit = (unsigned char *)pnode->lit;
+	size_t i;
+
+	pnode->skip = enmalloc(Error, 256 * sizeof(*pnode->skip));
+	for (i = 0; i < 256; i++)
+		pnode->skip[i] = pnode->litlen;
+	for (i = 0; i < pnode->litlen; i++) {
+		lit[i] = fold[lit[i]];
+		if (i + 1 < pnode->litlen)
+			pnode->skip[lit[i]] = pnode->litlen - 1 - i;
+	}
+}
+
+static const char *
+casefind(const char *buf, size_t len, const struct pattern *pnode)
+{
+	const unsigned char *s = (const unsigned char *)buf;
+	const unsigned char *lit = (const unsigned char *)pnode->lit;
+	size_t i, j, m = pnode->litlen;
+
+	if (m > len)
+		return NULL;
+	for (i = 0; i <= len - m; i += pnode->skip[fold[s[i + m - 1]]]) {
+		for (j = m; j && fold[s[i + j - 1]] == lit[j - 1]; j--)
+			;
+		if (!j)
+			return buf + i;
+	}
+
+	return NULL;
+}
+
+/* lines lacking the required literal of a pattern cannot match */
+static int
+haslit(const char *buf, size_t len, const struct pattern *pnode)
+{
+	if (!pnode->lit || vflag)
+		return 1;
+	if (iflag)
+		return casefind(buf, len, pnode) != NULL;
+
+	return memmem(buf, len, pnode->lit, pnode->litlen) != NULL;
+}
+
+static int
+matchline(const char *buf, size_t len)
+{
+	struct pattern *pnode;
+	const char *p;
+	int cand = 0;
+
+	if (nfastart >= 0) {
+		/* the automaton can only match if one of its literals occurs */
+		SLIST_FOREACH(pnode, &phead, entry) {
+			if (!pnode->indfa)
+				continue;
+			if (haslit(buf, len, pnode)) {
+				cand = 1;
+				break;
+			}
+		}
+		if (cand && dfaexec(buf))
+			return Match;
+		if (dslow > 2) {
+			/* hand all patterns back to regexec */
+			SLIST_FOREACH(pnode, &phead, entry)
+				pnode->indfa = 0;
+			nfastart = -1;
+			dfaflush();
+			return matchline(buf, len);
+		}
+	}
+	SLIST_FOREACH(pnode, &phead, entry) {
+		if (pnode->indfa)
+			continue;
+		if (!Fflag) {
+			if (haslit(buf, len, pnode) &&
+			    !regexec(&pnode->preg, buf, 0, NULL, 0))
+				return Match;
+		} else if (iflag) {
+			/* like strcasestr(3) and strcasecmp(3), stop at a NUL byte */
+			if (!xflag)
+				p = casefind(buf, len, pnode);
+			else if (len == pnode->litlen ||
+			         (len > pnode->litlen && !buf[pnode->litlen]))
+				p = casefind(buf, pnode->litlen, pnode);
+			else
+				p = NULL;
+			if (p && !memchr(buf, '\0', p - buf))
+				return Match;
+		} else if (!xflag) {
+			if (strstr(buf, pnode->pattern))
+				return Match;
+		} else {
+			if (!strcmp(buf, pnode->pattern))
+				return Match;
+		}
+	}
+
+	return NoMatch;
+}
+
+static int
+grepblock(FILE *fp, const char *str)
+{
+	static char *buf = NULL;
+	static size_t size = 0;
+	struct pattern *one = NULL;
+	const char *p;
+	char *s, *e, *end;
+	size_t n, have = 0;
+	long c = 0;
+	int match = NoMatch, eof = 0;
+
+	/* with a single pattern, jump straight to lines holding its literal */
+	if (!vflag && (one = SLIST_FIRST(&phead)) &&
+	    (SLIST_NEXT(one, entry) || !one->lit || !one->litlen))
+		one = NULL;
+
+	while (!eof) {
+		if (size - have < BUFSIZ * 16) {
+			size = have + BUFSIZ * 16;
+			buf = enrealloc(Error, buf, size);
+		}
+		/* leave room to terminate a last line lacking a newline */
+		if (!(n = fread(buf + have, 1, size - have - 1, fp))) {
+			if (!have)
+				break;
+			buf[have++] = '\n';
+			eof = 1;
+		}
+		have += n;
+
+		/* only complete lines are scanned */
+		for (end = buf + have; end > buf && end[-1] != '\n'; end--)
+			;
+		for (s = buf; s < end; s = e + 1) {
+			if (one) {
+				if (!(p = iflag ? casefind(s, end - s, one) :
+				                  memmem(s, end - s, one->lit, one->litlen)))
+					break;
+				for (; p > s && p[-1] != '\n'; p--)
+					;
+				s = (char *)p;
+			}
+			e = memchr(s, '\n', end - s);
+			*e = '\0';
+			if (matchline(s, e - s) ^ vflag)
+				continue;
+			match = Match;
+			if (mode == 'q')
+				exit(Match);
+			if (mode == 'l') {
+				puts(str);
+				goto end;
+			}
+			c++;
+		}
+		have -= end - buf;
+		memmove(buf, end, have);
+	}
+	if (mode == 'c') {
+		if (!hflag && (many || Hflag))
+			printf("%s:", str);
+		printf("%ld\n", c);
+	}
+end:
+	if (ferror(fp)) {
+		weprintf("%s: read error:", str);
+		match = Error;
+	}
+	return match;
+}
+
 static int
 grep(FILE *fp, const char *str)
 {
 	static char *buf = NULL;
 	static size_t size = 0;
+	struct stat st;
 	ssize_t len = 0;
 	long c = 0, n;
-	struct pattern *pnode;
 	int match = NoMatch;
 
+	/*
+	 * the lines themselves are not needed for -c, -l and -q, but on a
+	 * pipe or terminal a block may take long to fill
+	 */
+	if ((mode == 'c' || mode == 'l' || mode == 'q') &&
+	    !fstat(fileno(fp), &st) && S_ISREG(st.st_mode))
+		return grepblock(fp, str);
+
 	for (n = 1; (len = getline(&buf, &size, fp)) > 0; n++) {
 		/* Remove the trailing newline if one is present. */
 		if (len && buf[len - 1] == '\n')
-			buf[len - 1] = '\0';
-		SLIST_FOREACH(pnode, &phead, entry) {
-			if (!Fflag) {
-				if (regexec(&pnode->preg, buf, 0, NULL, 0) ^ vflag)
-					continue;
-			} else {
-				if (!xflag) {
-					if ((iflag ? strcasestr : strstr)(buf, pnode->pattern))
-						match = Match;
-					else
-						match = NoMatch;
-				} else {
-					if (!(iflag ? strcasecmp : strcmp)(buf, pnode->pattern))
-						match = Match;
-					else
-						match = NoMatch;
-				}
-				if (match ^ vflag)
-					continue;
-			}
-			switch (mode) {
-			case 'c':
-				c++;
-				break;
-			case 'l':
-				puts(str);
-				goto end;
-			case 'q':
-				exit(Match);
-			default:
-				if (!hflag && (many || Hflag))
-					printf("%s:", str);
-				if (mode == 'n')
-					printf("%ld:", n);
-				puts(buf);
-				break;
-			}
-			match = Match;
-			break;
+			buf[--len] = '\0';
+		if (matchline(buf, len) ^ vflag)
+			continue;
+		match = Match;
+		switch (mode) {
+		case 'c':
+			c++;
+			continue;
+		case 'l':
+			puts(str);
+			goto end;
+		case 'q':
+			exit(Match);
 		}
+		if (!hflag && (many || Hflag))
+			printf("%s:", str);
+		if (mode == 'n')
+			printf("%ld:", n);
+		puts(buf);
 	}
-	if (mode == 'c')
+	if (mode == 'c') {
+		if (!hflag && (many || Hflag))
+			printf("%s:", str);
 		printf("%ld\n", c);
+	}
 end:
 	if (ferror(fp)) {
 		weprintf("%s: read error:", str);
@@ -163,16 +1079,59 @@ end:
 	return match;
 }
 
+/* a NUL byte in the first block marks a file as binary */
+static int
+isbinary(FILE *fp)
+{
+	char buf[BUFSIZ];
+	size_t n;
+
+	n = fread(buf, 1, sizeof(buf), fp);
+	rewind(fp);
+
+	return memchr(buf, '\0', n) != NULL;
+}
+
+static void
+grepr(const char *path, struct stat *st, void *data, struct recursor *r)
+{
+	FILE *fp;
+	int *match = data, m;
+
+	if (st && S_ISDIR(st->st_mode)) {
+		recurse(path, data, r);
+		return;
+	}
+	/* only search regular files found in directories */
+	if (r->depth && (!st || !S_ISREG(st->st_mode)))
+		return;
+	if (!(fp = fopen(path, "r"))) {
+		if (!sflag)
+			weprintf("fopen %s:", path);
+		*match = Error;
+		return;
+	}
+	if (!r->depth || !isbinary(fp)) {
+		m = grep(fp, path);
+		if (m == Error || (*match != Error && m == Match))
+			*match = m;
+	}
+	if (fshut(fp, path))
+		*match = Error;
+}
+
 static void
 usage(void)
 {
-	enprintf(Error, "usage: %s [-EFHchilnqsvwx] [-e pattern] [-f file] "
+	enprintf(Error, "usage: %s [-EFHchilnqrsvwx] [-e pattern] [-f file] "
 	         "[pattern] [file ...]\n", argv0);
 }
 
 int
 main(int argc, char *argv[])
 {
+	struct recursor r = { .fn = grepr, .hist = NULL, .depth = 0, .maxdepth = 0,
+	                      .follow = 'H', .flags = 0 };
 	struct pattern *pnode;
 	int m, flags = REG_NOSUB, match = NoMatch;
 	FILE *fp;
@@ -226,8 +1185,12 @@ main(int argc, char *argv[])
 		flags |= REG_ICASE;
 		iflag = 1;
 		break;
+	case 'r':
+		rflag = 1;
+		break;
 	case 's':
 		sflag = 1;
+		r.flags |= SILENT;
 		break;
 	case 'v':
 		vflag = 1;
@@ -255,16 +1218,36 @@ main(int argc, char *argv[])
 		argv++;
 	}
 
-	if (!Fflag)
+	for (m = 0; m < 256; m++)
+		fold[m] = tolower(m);
+	SLIST_FOREACH(pnode, &phead, entry) {
+		if (Fflag) {
+			pnode->lit = pnode->pattern;
+			pnode->litlen = strlen(pnode->pattern);
+		}
+		if (iflag && pnode->lit)
+			foldliteral(pnode);
+	}
+
+	if (!Fflag) {
 		/* Compile regex for all search patterns */
-		SLIST_FOREACH(pnode, &phead, entry)
+		SLIST_FOREACH(pnode, &phead, entry) {
 			enregcomp(Error, &pnode->preg, pnode->pattern, flags);
-	many = (argc > 1);
-	if (argc == 0) {
+			pnode->indfa = dfaadd(pnode->pattern);
+		}
+		dfacomp();
+	}
+	many = (argc > 1) || rflag;
+	if (argc == 0 && rflag) {
+		recurse(".", &match, &r);
+	} else if (argc == 0) {
 		match = grep(stdin, "<stdin>");
 	} else {
 		for (; *argv; argc--, argv++) {
-			if (!strcmp(*argv, "-")) {
+			if (rflag && strcmp(*argv, "-")) {
+				recurse(*argv, &match, &r);
+				continue;
+			} else if (!strcmp(*argv, "-")) {
 				*argv = "<stdin>";
 				fp = stdin;
 			} else if (!(fp = fopen(*argv, "r"))) {
@@ -281,6 +1264,8 @@ main(int argc, char *argv[])
 		}
 	}
 
+	if (recurse_status)
+		match = Error;
 	if (fshut(stdin, "<stdin>") | fshut(stdout, "<stdout>"))
 		match = Error;
 
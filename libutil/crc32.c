@@ -0,0 +1,27 @@
+/* See LICENSE file for copyright and license details. */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../deflate.h"
+
+uint32_t
+crc32(uint32_t crc, const void *m, size_t len)
+{
+	static uint32_t tab[256];
+	const uint8_t *p = m;
+	uint32_t c;
+	int i, j;
+
+	if (!tab[1]) {
+		for (i = 0; i < 256; i++) {
+			for (c = i, j = 0; j < 8; j++)
+				c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+			tab[i] = c;
+		}
+	}
+
+	crc = ~crc;
+	while (len--)
+		crc = tab[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
@@ -1,13 +1,22 @@
 /* See LICENSE file for copyright and license details. */
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <errno.h>
+#include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "../crypt.h"
 #include "../text.h"
 #include "../util.h"
 
+int crypt_jobs = 1;
+int crypt_failfast;
+
 static int
 hexdec(int c)
 {
@@ -37,44 +46,257 @@ mdcheckline(const char *s, uint8_t *md, size_t sz)
 	return (i == sz) ? 1 : 0;
 }
 
+enum { OK, FAILED, NOREAD, BADLINE, PENDING };
+
+/* a checklist entry not yet verified, by inode so the disk is read
+ * more or less in order */
+struct check {
+	char *line;
+	char *file;      /* NULL if the line is malformed */
+	dev_t dev;
+	ino_t ino;
+	int r;
+};
+
+/* split a checklist line into sum and file name */
+static char *
+parseline(char *line, size_t sz)
+{
+	char *file, *p;
+
+	if (!(file = strstr(line, "  ")))
+		return NULL;
+	if ((file - line) / 2 != sz)
+		return NULL; /* checksum length mismatch */
+	*file = '\0';
+	file += 2;
+	for (p = file; *p && *p != '\n' && *p != '\r'; p++); /* strip newline */
+	*p = '\0';
+	return file;
+}
+
+static int
+checkfile(struct crypt_ops *ops, const char *file, const char *line,
+          uint8_t *md, size_t sz)
+{
+	FILE *fp;
+	int r;
+
+	if (!(fp = fopen(file, "r"))) {
+		weprintf("fopen %s:", file);
+		return NOREAD;
+	}
+	if (cryptsum(ops, fp, file, md)) {
+		fclose(fp);
+		return NOREAD;
+	}
+	fclose(fp);
+	r = mdcheckline(line, md, sz);
+	return r == 1 ? OK : r == 0 ? FAILED : BADLINE;
+}
+
+static void
+report(int r, const char *file, int *formatsucks, int *noread, int *nonmatch)
+{
+	switch (r) {
+	case OK:
+		printf("%s: OK\n", file);
+		break;
+	case FAILED:
+		printf("%s: FAILED\n", file);
+		(*nonmatch)++;
+		break;
+	case NOREAD:
+		(*noread)++;
+		break;
+	case BADLINE:
+		(*formatsucks)++;
+		break;
+	}
+}
+
+static void
+writeall(int fd, const void *buf, size_t n)
+{
+	const char *p = buf;
+	ssize_t r;
+
+	for (; n; n -= r, p += r)
+		if ((r = write(fd, p, n)) < 0 && errno != EINTR)
+			eprintf("write:");
+		else if (r < 0)
+			r = 0;
+}
+
+static int
+readall(int fd, void *buf, size_t n)
+{
+	char *p = buf;
+	ssize_t r;
+
+	for (; n; n -= r, p += r)
+		if ((r = read(fd, p, n)) < 0 && errno != EINTR)
+			eprintf("read:");
+		else if (!r)
+			return -1;
+		else if (r < 0)
+			r = 0;
+	return 0;
+}
+
+/* fork njobs children, returns the job number in a child, which
+ * writes to fd[0], and -1 in the parent, which reads job j from fd[j] */
+static int
+spawn(int njobs, pid_t *pid, int *fd)
+{
+	int fds[2], i, j;
+
+	fflush(stdout);
+	for (j = 0; j < njobs; j++) {
+		if (pipe(fds) < 0)
+			eprintf("pipe:");
+		switch ((pid[j] = fork())) {
+		case -1:
+			eprintf("fork:");
+		case 0:
+			for (i = 0; i < j; i++)
+				close(fd[i]);
+			close(fds[0]);
+			fd[0] = fds[1];
+			return j;
+		}
+		close(fds[1]);
+		fd[j] = fds[0];
+	}
+	return -1;
+}
+
+/* wait for the jobs, stopping them first if asked to, 1 if one failed */
+static int
+reap(int njobs, pid_t *pid, int *fd, int stop)
+{
+	int j, status, ret = 0;
+
+	for (j = 0; j < njobs; j++) {
+		close(fd[j]);
+		if (stop)
+			kill(pid[j], SIGTERM);
+	}
+	for (j = 0; j < njobs; j++) {
+		if (waitpid(pid[j], &status, 0) < 0)
+			eprintf("waitpid:");
+		if (!stop && (!WIFEXITED(status) || WEXITSTATUS(status)))
+			ret = 1;
+	}
+	return ret;
+}
+
+static int
+inodecmp(const void *a, const void *b)
+{
+	const struct check *c = *(struct check **)a, *d = *(struct check **)b;
+
+	if (c->dev != d->dev)
+		return c->dev < d->dev ? -1 : 1;
+	if (c->ino != d->ino)
+		return c->ino < d->ino ? -1 : 1;
+	return (c > d) - (c < d);
+}
+
+/* the whole list is read first, then the files are checked by jobs in
+ * inode order and reported in list order */
+static void
+mdcheckjobs(FILE *listfp, struct crypt_ops *ops, uint8_t *md, size_t sz,
+            int *formatsucks, int *noread, int *nonmatch)
+{
+	struct check *c = NULL, **order;
+	struct stat st;
+	pid_t *pid;
+	size_t n = 0, nord = 0, bufsiz = 0, i, k, next = 0;
+	uint8_t r;
+	int *fd, njobs, j, stop = 0;
+	char *line = NULL;
+
+	while (getline(&line, &bufsiz, listfp) > 0) {
+		c = ereallocarray(c, n + 1, sizeof(*c));
+		c[n].line = estrdup(line);
+		c[n].file = parseline(c[n].line, sz);
+		c[n].r = c[n].file ? PENDING : BADLINE;
+		c[n].dev = c[n].ino = 0;
+		if (c[n].file && !stat(c[n].file, &st)) {
+			c[n].dev = st.st_dev;
+			c[n].ino = st.st_ino;
+		}
+		n++;
+	}
+	free(line);
+
+	order = ereallocarray(NULL, n + 1, sizeof(*order));
+	for (i = 0; i < n; i++)
+		if (c[i].file)
+			order[nord++] = &c[i];
+	qsort(order, nord, sizeof(*order), inodecmp);
+
+	njobs = MIN((size_t)crypt_jobs, nord);
+	pid = ecalloc(njobs + 1, sizeof(*pid));
+	fd = ecalloc(njobs + 1, sizeof(*fd));
+	if ((j = spawn(njobs, pid, fd)) >= 0) {
+		for (k = j; k < nord; k += njobs) {
+			r = checkfile(ops, order[k]->file, order[k]->line, md, sz);
+			writeall(fd[0], &r, 1);
+		}
+		_exit(0);
+	}
+
+	for (k = 0; k <= nord; k++) {
+		if (k < nord) {
+			if (readall(fd[k % njobs], &r, 1) < 0)
+				r = NOREAD;
+			order[k]->r = r;
+			/* a failure is reported as soon as it is found,
+			 * after what is done before it in the list */
+			if (crypt_failfast && (r == FAILED || r == NOREAD)) {
+				for (; next < n && c[next].r != PENDING && &c[next] != order[k]; next++)
+					report(c[next].r, c[next].file, formatsucks, noread, nonmatch);
+				report(r, order[k]->file, formatsucks, noread, nonmatch);
+				stop = 1;
+				break;
+			}
+		}
+		for (; next < n && c[next].r != PENDING; next++)
+			report(c[next].r, c[next].file, formatsucks, noread, nonmatch);
+	}
+	reap(njobs, pid, fd, stop);
+
+	for (i = 0; i < n; i++)
+		free(c[i].line);
+	free(c);
+	free(order);
+	free(pid);
+	free(fd);
+}
+
 static void
 mdchecklist(FILE *listfp, struct crypt_ops *ops, uint8_t *md, size_t sz,
             int *formatsucks, int *noread, int *nonmatch)
 {
-	FILE *fp;
 	size_t bufsiz = 0;
 	int r;
-	char *line = NULL, *file, *p;
+	char *line = NULL, *file;
 
+	if (crypt_jobs > 1) {
+		mdcheckjobs(listfp, ops, md, sz, formatsucks, noread, nonmatch);
+		return;
+	}
 	while (getline(&line, &bufsiz, listfp) > 0) {
-		if (!(file = strstr(line, "  "))) {
+		if (!(file = parseline(line, sz))) {
 			(*formatsucks)++;
 			continue;
 		}
-		if ((file - line) / 2 != sz) {
-			(*formatsucks)++; /* checksum length mismatch */
-			continue;
-		}
-		*file = '\0';
-		file += 2;
-		for (p = file; *p && *p != '\n' && *p != '\r'; p++); /* strip newline */
-		*p = '\0';
-		if (!(fp = fopen(file, "r"))) {
-			weprintf("fopen %s:", file);
-			(*noread)++;
-			continue;
-		}
-		cryptsum(ops, fp, file, md);
-		r = mdcheckline(line, md, sz);
-		if (r == 1) {
-			printf("%s: OK\n", file);
-		} else if (r == 0) {
-			printf("%s: FAILED\n", file);
-			(*nonmatch)++;
-		} else {
-			(*formatsucks)++;
-		}
-		fclose(fp);
+		r = checkfile(ops, file, line, md, sz);
+		report(r, file, formatsucks, noread, nonmatch);
+		if (crypt_failfast && (r == FAILED || r == NOREAD))
+			break;
 	}
 	free(line);
 }
@@ -89,6 +311,8 @@ cryptcheck(int argc, char *argv[], struct crypt_ops *ops, uint8_t *md, size_t sz
 		mdchecklist(stdin, ops, md, sz, &formatsucks, &noread, &nonmatch);
 	} else {
 		for (; *argv; argc--, argv++) {
+			if (crypt_failfast && (noread || nonmatch))
+				break;
 			if (!(fp = fopen(*argv, "r"))) {
 				weprintf("fopen %s:", *argv);
 				ret = 1;
@@ -115,11 +339,64 @@ cryptcheck(int argc, char *argv[], struct crypt_ops *ops, uint8_t *md, size_t sz
 	return ret;
 }
 
+/* file i is summed by job i % crypt_jobs, which sends back a status
+ * byte and the sum through a pipe, so they are printed in order */
+static int
+cryptjobs(int argc, char *argv[], struct crypt_ops *ops, uint8_t *md, size_t sz)
+{
+	FILE *fp;
+	pid_t *pid;
+	uint8_t *res;
+	int *fd, njobs, i, j, ret = 0;
+
+	njobs = MIN(crypt_jobs, argc);
+	pid = ecalloc(njobs, sizeof(*pid));
+	fd = ecalloc(njobs, sizeof(*fd));
+	res = emalloc(sz + 1);
+	if ((j = spawn(njobs, pid, fd)) >= 0) {
+		for (i = j; i < argc; i += njobs) {
+			res[0] = 1;
+			if (!(fp = fopen(argv[i], "r")))
+				weprintf("fopen %s:", argv[i]);
+			else if (!cryptsum(ops, fp, argv[i], res + 1))
+				res[0] = 0;
+			if (fp && fshut(fp, argv[i]))
+				res[0] = 1;
+			writeall(fd[0], res, sz + 1);
+		}
+		_exit(0);
+	}
+
+	for (i = 0; i < argc; i++) {
+		if (readall(fd[i % njobs], res, sz + 1) < 0) {
+			ret = 1;
+			break;
+		}
+		if (res[0])
+			ret = 1;
+		else
+			mdprint(res + 1, argv[i], sz);
+	}
+	ret |= reap(njobs, pid, fd, 0);
+	free(pid);
+	free(fd);
+	free(res);
+
+	return ret;
+}
+
 int
 cryptmain(int argc, char *argv[], struct crypt_ops *ops, uint8_t *md, size_t sz)
 {
 	FILE *fp;
-	int ret = 0;
+	int i, ret = 0;
+
+	/* stdin can only be read once, in order */
+	for (i = 0; i < argc; i++)
+		if (argv[i][0] == '-' && !argv[i][1])
+			break;
+	if (crypt_jobs > 1 && argc > 1 && i == argc)
+		return cryptjobs(argc, argv, ops, md, sz);
 
 	if (argc == 0) {
 		cryptsum(ops, stdin, "<stdin>", md);
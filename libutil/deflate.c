@@ -0,0 +1,441 @@
+/* See LICENSE file for copyright and license details. */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../deflate.h"
+#include "../util.h"
+
+enum {
+	WSIZE    = 1 << 15,  /* how far back a match can be */
+	BSIZE    = 1 << 17,  /* bytes compressed as one block */
+	HBITS    = 15,
+	MINMATCH = 3,
+	MAXMATCH = 258,
+	MAXCHAIN = 64,       /* earlier positions tried for a match */
+	NICE     = 128,      /* a match this long is taken at once */
+	LAZY     = 16,       /* look for a longer match after a shorter one */
+};
+
+static const uint16_t lbase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t lext[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t dbase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577
+};
+static const uint8_t dext[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t clorder[19] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+/* length to its code, distance - 1 to its code as in zlib */
+static uint8_t lcode[MAXMATCH + 1];
+static uint8_t dcode[512];
+
+#define DCODE(d) ((d) <= 256 ? dcode[(d) - 1] : dcode[256 + (((d) - 1) >> 7)])
+
+static void
+putbits(struct deflate *d, uint32_t v, int n)
+{
+	d->bits |= v << d->nbits;
+	for (d->nbits += n; d->nbits >= 8; d->nbits -= 8) {
+		d->out[d->outlen++] = d->bits;
+		d->bits >>= 8;
+	}
+}
+
+static void
+put32(struct deflate *d, uint32_t v)
+{
+	putbits(d, v & 0xffff, 16);
+	putbits(d, v >> 16, 16);
+}
+
+static void
+reserve(struct deflate *d, size_t n)
+{
+	if (d->outsiz - d->outlen < n) {
+		d->outsiz = d->outlen + n;
+		d->out = erealloc(d->out, d->outsiz);
+	}
+}
+
+/* code lengths of at most limit bits for the n symbols of freq */
+static void
+buildlens(const uint32_t *freq, int n, int limit, uint8_t *len)
+{
+	uint32_t f[288], w[2 * 288];
+	int sym[288], parent[2 * 288], depth[2 * 288];
+	int i, j, k, m, leaf, node, a, b, max, t;
+
+	for (i = 0; i < n; i++)
+		f[i] = freq[i];
+	for (;;) {
+		/* symbols used, by frequency */
+		for (i = m = 0; i < n; i++) {
+			len[i] = 0;
+			if (!f[i])
+				continue;
+			for (j = m++; j > 0 && f[sym[j - 1]] > f[i]; j--)
+				sym[j] = sym[j - 1];
+			sym[j] = i;
+		}
+		if (m < 2) {
+			/* one bit for it and another symbol,
+			 * some decoders want complete codes */
+			j = m ? sym[0] : 0;
+			len[j] = 1;
+			len[j ? 0 : 1] = 1;
+			return;
+		}
+
+		/* leaves and the nodes made of them both come in
+		 * order of weight, take the lightest two each time */
+		for (i = 0; i < m; i++)
+			w[i] = f[sym[i]];
+		for (leaf = 0, node = k = m; k < 2 * m - 1; k++) {
+			for (t = 0; t < 2; t++) {
+				if (leaf < m && (node == k || w[leaf] <= w[node]))
+					j = leaf++;
+				else
+					j = node++;
+				parent[j] = k;
+				if (t)
+					b = j;
+				else
+					a = j;
+			}
+			w[k] = w[a] + w[b];
+		}
+		depth[2 * m - 2] = 0;
+		for (k = 2 * m - 3, max = 0; k >= 0; k--) {
+			depth[k] = depth[parent[k]] + 1;
+			if (k < m && depth[k] > max)
+				max = depth[k];
+		}
+		if (max <= limit)
+			break;
+		/* flatten the frequencies and try again */
+		for (i = 0; i < n; i++)
+			if (f[i])
+				f[i] = (f[i] >> 1) | 1;
+	}
+	for (i = 0; i < m; i++)
+		len[sym[i]] = depth[i];
+}
+
+/* canonical codes, bit reversed as they are written lsb first */
+static void
+buildcodes(const uint8_t *len, int n, uint16_t *code)
+{
+	int count[16] = { 0 }, next[16], i, j, c;
+
+	for (i = 0; i < n; i++)
+		count[len[i]]++;
+	count[0] = 0;
+	for (i = 1, c = 0; i < 16; i++)
+		next[i] = c = (c + count[i - 1]) << 1;
+	for (i = 0; i < n; i++) {
+		if (!len[i])
+			continue;
+		for (c = next[len[i]]++, code[i] = 0, j = 0; j < len[i]; j++, c >>= 1)
+			code[i] = (code[i] << 1) | (c & 1);
+	}
+}
+
+static void
+fixedlens(uint8_t *llen, uint8_t *dlen)
+{
+	int i;
+
+	for (i = 0; i < 288; i++)
+		llen[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+	for (i = 0; i < 30; i++)
+		dlen[i] = 5;
+}
+
+static uint32_t
+hash(const uint8_t *p)
+{
+	return ((p[0] << 16 | p[1] << 8 | p[2]) * 2654435761U) >> (32 - HBITS);
+}
+
+static void
+insert(struct deflate *d, size_t *ins, size_t to)
+{
+	uint32_t h;
+
+	for (; *ins < to && *ins + MINMATCH <= d->len; (*ins)++) {
+		h = hash(d->buf + *ins);
+		d->prev[*ins] = d->head[h];
+		d->head[h] = *ins + 1;
+	}
+}
+
+static int
+longest(struct deflate *d, size_t *ins, size_t p, size_t *dist)
+{
+	const uint8_t *b = d->buf;
+	size_t c, max = MIN(MAXMATCH, d->len - p), best = 0, l;
+	int chain = MAXCHAIN;
+
+	if (d->len - p < MINMATCH) {
+		insert(d, ins, p + 1);
+		return 0;
+	}
+	insert(d, ins, p);
+	for (c = d->head[hash(b + p)]; c-- && p - c <= WSIZE && chain--; c = d->prev[c]) {
+		if (b[c + best] != b[p + best] || b[c] != b[p])
+			continue;
+		for (l = 0; l < max && b[c + l] == b[p + l]; l++)
+			;
+		if (l > best) {
+			best = l;
+			*dist = p - c;
+			if (l >= NICE || l == max)
+				break;
+		}
+	}
+	insert(d, ins, p + 1);
+	return best >= MINMATCH ? best : 0;
+}
+
+static void
+putstored(struct deflate *d, int last)
+{
+	size_t p, n;
+
+	for (p = d->start; ; p += n) {
+		n = MIN(d->len - p, 65535);
+		putbits(d, last && p + n == d->len, 1);
+		putbits(d, 0, 2);
+		if (d->nbits)
+			putbits(d, 0, 8 - d->nbits);
+		putbits(d, n, 16);
+		putbits(d, ~n & 0xffff, 16);
+		memcpy(d->out + d->outlen, d->buf + p, n);
+		d->outlen += n;
+		if (p + n == d->len)
+			break;
+	}
+}
+
+static void
+block(struct deflate *d, int last)
+{
+	uint32_t lfreq[286] = { 0 }, dfreq[30] = { 0 }, cfreq[19] = { 0 };
+	uint8_t llen[288], dlen[30], clen[19], flen[288], fdlen[30], all[286 + 30], rle[286 + 30];
+	uint8_t rlex[286 + 30];
+	uint16_t lcodes[288], dcodes[30], ccodes[19];
+	size_t ntok = 0, ins = 0, p, dist, dist2, i, nrle = 0, dyn, fixed, stored, xbits = 0;
+	int l, l2, nl, nd, nc, run, r, s;
+
+	/* find matches, looking one byte ahead for a longer one */
+	for (p = d->start; p < d->len;) {
+		if (!(l = longest(d, &ins, p, &dist))) {
+			d->tlen[ntok] = d->buf[p++];
+			d->tdist[ntok++] = 0;
+			continue;
+		}
+		while (l < LAZY && p + 1 < d->len) {
+			if ((l2 = longest(d, &ins, p + 1, &dist2)) <= l)
+				break;
+			d->tlen[ntok] = d->buf[p++];
+			d->tdist[ntok++] = 0;
+			l = l2;
+			dist = dist2;
+		}
+		d->tlen[ntok] = l;
+		d->tdist[ntok++] = dist;
+		p += l;
+	}
+
+	for (i = 0; i < ntok; i++) {
+		if (!d->tdist[i]) {
+			lfreq[d->tlen[i]]++;
+			continue;
+		}
+		lfreq[257 + lcode[d->tlen[i]]]++;
+		dfreq[DCODE(d->tdist[i])]++;
+		xbits += lext[lcode[d->tlen[i]]] + dext[DCODE(d->tdist[i])];
+	}
+	lfreq[256] = 1;
+	buildlens(lfreq, 286, 15, llen);
+	llen[286] = llen[287] = 0;
+	buildlens(dfreq, 30, 15, dlen);
+	for (nl = 286; !llen[nl - 1]; nl--)
+		;
+	for (nd = 30; !dlen[nd - 1]; nd--)
+		;
+
+	/* run length encode the code lengths */
+	memcpy(all, llen, nl);
+	memcpy(all + nl, dlen, nd);
+	for (i = 0; i < (size_t)(nl + nd); i += run) {
+		for (run = 1; i + run < (size_t)(nl + nd) && all[i + run] == all[i]; run++)
+			;
+		if (!all[i] && run >= 3) {
+			run = MIN(run, 138);
+			rle[nrle] = run <= 10 ? 17 : 18;
+			rlex[nrle++] = run - (run <= 10 ? 3 : 11);
+		} else if (all[i] && run >= 4) {
+			run = MIN(run, 7);
+			rle[nrle++] = all[i];
+			rle[nrle] = 16;
+			rlex[nrle++] = run - 4;
+		} else {
+			run = 1;
+			rle[nrle++] = all[i];
+		}
+	}
+	for (i = 0; i < nrle; i++)
+		cfreq[rle[i]]++;
+	buildlens(cfreq, 19, 7, clen);
+	for (nc = 19; !clen[clorder[nc - 1]]; nc--)
+		;
+	nc = MAX(nc, 4);
+
+	/* choose the smallest of a dynamic, fixed or stored block */
+	fixedlens(flen, fdlen);
+	dyn = 3 + 14 + 3 * nc + xbits;
+	fixed = 3 + xbits;
+	for (i = 0; i < nrle; i++)
+		dyn += clen[rle[i]] + (rle[i] == 16 ? 2 : rle[i] == 17 ? 3 : rle[i] == 18 ? 7 : 0);
+	for (i = 0; i < 286; i++) {
+		dyn += (size_t)lfreq[i] * llen[i];
+		fixed += (size_t)lfreq[i] * flen[i];
+	}
+	for (i = 0; i < 30; i++) {
+		dyn += (size_t)dfreq[i] * dlen[i];
+		fixed += (size_t)dfreq[i] * 5;
+	}
+	stored = (d->len - d->start) * 8 + ((d->len - d->start) / 65535 + 1) * 42;
+
+	reserve(d, (d->len - d->start) + (d->len - d->start) / 65535 * 5 + 64);
+	if (stored <= dyn && stored <= fixed && d->len > d->start) {
+		putstored(d, last);
+		return;
+	}
+	putbits(d, last, 1);
+	if (fixed <= dyn) {
+		putbits(d, 1, 2);
+		memcpy(llen, flen, sizeof(llen));
+		memcpy(dlen, fdlen, sizeof(dlen));
+	} else {
+		putbits(d, 2, 2);
+		putbits(d, nl - 257, 5);
+		putbits(d, nd - 1, 5);
+		putbits(d, nc - 4, 4);
+		for (i = 0; i < (size_t)nc; i++)
+			putbits(d, clen[clorder[i]], 3);
+		buildcodes(clen, 19, ccodes);
+		for (i = 0; i < nrle; i++) {
+			s = rle[i];
+			putbits(d, ccodes[s], clen[s]);
+			if (s >= 16)
+				putbits(d, rlex[i], s == 16 ? 2 : s == 17 ? 3 : 7);
+		}
+	}
+	buildcodes(llen, 288, lcodes);
+	buildcodes(dlen, 30, dcodes);
+	for (i = 0; i < ntok; i++) {
+		if (!d->tdist[i]) {
+			putbits(d, lcodes[d->tlen[i]], llen[d->tlen[i]]);
+			continue;
+		}
+		r = lcode[d->tlen[i]];
+		putbits(d, lcodes[257 + r], llen[257 + r]);
+		putbits(d, d->tlen[i] - lbase[r], lext[r]);
+		r = DCODE(d->tdist[i]);
+		putbits(d, dcodes[r], dlen[r]);
+		putbits(d, d->tdist[i] - dbase[r], dext[r]);
+	}
+	putbits(d, lcodes[256], llen[256]);
+}
+
+static void
+compress(struct deflate *d, int last)
+{
+	block(d, last);
+
+	/* keep a window of history for the next block */
+	if (d->len > WSIZE) {
+		memmove(d->buf, d->buf + d->len - WSIZE, WSIZE);
+		d->len = WSIZE;
+	}
+	d->start = d->len;
+	memset(d->head, 0, (1 << HBITS) * sizeof(*d->head));
+}
+
+void
+deflate_init(struct deflate *d)
+{
+	static const uint8_t hdr[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3 };
+	int c, i;
+
+	if (!lcode[4]) {
+		for (c = 0; c < 29; c++)
+			for (i = lbase[c]; i < (c == 28 ? 259 : lbase[c + 1]); i++)
+				lcode[i] = c;
+		for (c = 0; c < 30; c++)
+			for (i = dbase[c]; i < dbase[c] + (1 << dext[c]); i++)
+				if (i <= 256)
+					dcode[i - 1] = c;
+				else
+					dcode[256 + ((i - 1) >> 7)] = c;
+	}
+
+	memset(d, 0, sizeof(*d));
+	d->buf = emalloc(WSIZE + BSIZE);
+	d->head = ecalloc(1 << HBITS, sizeof(*d->head));
+	d->prev = emalloc((WSIZE + BSIZE) * sizeof(*d->prev));
+	d->tlen = emalloc(BSIZE * sizeof(*d->tlen));
+	d->tdist = emalloc(BSIZE * sizeof(*d->tdist));
+	reserve(d, sizeof(hdr));
+	memcpy(d->out, hdr, sizeof(hdr));
+	d->outlen = sizeof(hdr);
+}
+
+void
+deflate_update(struct deflate *d, const void *m, size_t len)
+{
+	const uint8_t *p = m;
+	size_t n;
+
+	d->crc = crc32(d->crc, m, len);
+	d->isize += len;
+	for (; len; len -= n, p += n) {
+		if (d->len - d->start == BSIZE)
+			compress(d, 0);
+		n = MIN(len, BSIZE - (d->len - d->start));
+		memcpy(d->buf + d->len, p, n);
+		d->len += n;
+	}
+}
+
+void
+deflate_finish(struct deflate *d)
+{
+	compress(d, 1);
+	reserve(d, 16);
+	if (d->nbits)
+		putbits(d, 0, 8 - d->nbits);
+	put32(d, d->crc);
+	put32(d, d->isize);
+
+	free(d->buf);
+	free(d->head);
+	free(d->prev);
+	free(d->tlen);
+	free(d->tdist);
+}
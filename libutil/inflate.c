@@ -0,0 +1,360 @@
+/* See LICENSE file for copyright and license details. */
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../deflate.h"
+#include "../util.h"
+
+enum {
+	INSIZ = 1 << 16,
+	WINSIZ = 1 << 16,    /* twice the history a match can refer to */
+	HIST = 1 << 15,
+	MAXMATCH = 258,
+	TBITS = 9,           /* codes this short are found by table lookup */
+};
+
+enum { HEADER, BLOCK, STORED, HUFF, TRAILER, END };
+
+static const uint16_t lbase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t lext[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t dbase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577
+};
+static const uint8_t dext[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t clorder[19] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+static void
+corrupt(void)
+{
+	eprintf("inflate: invalid compressed data\n");
+}
+
+/* one more byte of input into bits, 0 at the end of input */
+static int
+refill(struct inflate *z)
+{
+	ssize_t r;
+
+	if (z->inoff == z->inlen) {
+		while ((r = read(z->fd, z->in, INSIZ)) < 0)
+			if (errno != EINTR)
+				eprintf("read:");
+		if (!r)
+			return 0;
+		z->inoff = 0;
+		z->inlen = r;
+	}
+	z->bits |= (uint32_t)z->in[z->inoff++] << z->nbits;
+	z->nbits += 8;
+	return 1;
+}
+
+static uint32_t
+getbits(struct inflate *z, int n)
+{
+	uint32_t v;
+
+	while (z->nbits < n)
+		if (!refill(z))
+			eprintf("inflate: unexpected end of data\n");
+	v = z->bits & ((1UL << n) - 1);
+	z->bits >>= n;
+	z->nbits -= n;
+	return v;
+}
+
+/* counts of each code length, symbols in code order and a
+ * table of symbol | length << 9 by the first TBITS bits */
+static void
+build(const uint8_t *len, int n, uint16_t *count, uint16_t *sym, uint16_t *tab)
+{
+	int off[16], i, j, k, c, code, left, rev;
+
+	memset(count, 0, 16 * sizeof(*count));
+	for (i = 0; i < n; i++)
+		count[len[i]]++;
+	count[0] = 0;
+	for (i = 1, left = 1; i < 16; i++)
+		if ((left = (left << 1) - count[i]) < 0)
+			corrupt();
+	for (off[1] = 0, i = 1; i < 15; i++)
+		off[i + 1] = off[i] + count[i];
+	for (i = 0; i < n; i++)
+		if (len[i])
+			sym[off[len[i]]++] = i;
+
+	memset(tab, 0, (1 << TBITS) * sizeof(*tab));
+	for (i = 1, code = 0, j = 0; i <= TBITS; i++, code <<= 1) {
+		for (c = 0; c < count[i]; c++, code++, j++) {
+			for (k = rev = 0; k < i; k++)
+				rev |= ((code >> k) & 1) << (i - 1 - k);
+			for (k = rev; k < 1 << TBITS; k += 1 << i)
+				tab[k] = sym[j] | i << 9;
+		}
+	}
+}
+
+static int
+decode(struct inflate *z, const uint16_t *count, const uint16_t *sym, const uint16_t *tab)
+{
+	int len, code, first, index;
+	uint16_t e;
+
+	while (z->nbits < TBITS && refill(z))
+		;
+	e = tab[z->bits & ((1 << TBITS) - 1)];
+	if (e && e >> 9 <= z->nbits) {
+		z->bits >>= e >> 9;
+		z->nbits -= e >> 9;
+		return e & 511;
+	}
+
+	/* longer codes one bit at a time, as in puff */
+	for (len = 1, code = first = index = 0; len < 16; len++) {
+		code |= getbits(z, 1);
+		if (code - count[len] < first)
+			return sym[index + (code - first)];
+		index += count[len];
+		first = (first + count[len]) << 1;
+		code <<= 1;
+	}
+	corrupt();
+	return 0;
+}
+
+static void
+tables(struct inflate *z, int type)
+{
+	uint8_t len[286 + 30], clen[19] = { 0 };
+	uint16_t ccount[16], csym[19], ctab[1 << TBITS];
+	int nl, nd, nc, i, s, n, v;
+
+	if (type == 1) {
+		for (i = 0; i < 288; i++)
+			len[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+		build(len, 288, z->lcount, z->lsym, z->ltab);
+		memset(len, 5, 30);
+		build(len, 30, z->dcount, z->dsym, z->dtab);
+		return;
+	}
+
+	nl = getbits(z, 5) + 257;
+	nd = getbits(z, 5) + 1;
+	nc = getbits(z, 4) + 4;
+	if (nl > 286 || nd > 30)
+		corrupt();
+	for (i = 0; i < nc; i++)
+		clen[clorder[i]] = getbits(z, 3);
+	build(clen, 19, ccount, csym, ctab);
+	for (i = 0; i < nl + nd; i += n) {
+		s = decode(z, ccount, csym, ctab);
+		if (s < 16) {
+			len[i] = s;
+			n = 1;
+			continue;
+		}
+		if (s == 16) {
+			if (!i)
+				corrupt();
+			v = len[i - 1];
+			n = 3 + getbits(z, 2);
+		} else {
+			v = 0;
+			n = s == 17 ? 3 + getbits(z, 3) : 11 + getbits(z, 7);
+		}
+		if (i + n > nl + nd)
+			corrupt();
+		memset(len + i, v, n);
+	}
+	if (!len[256])
+		corrupt();
+	build(len, nl, z->lcount, z->lsym, z->ltab);
+	build(len + nl, nd, z->dcount, z->dsym, z->dtab);
+}
+
+static void
+put(struct inflate *z, int c)
+{
+	z->win[z->wpos++ & (WINSIZ - 1)] = c;
+	z->avail++;
+}
+
+static void
+header(struct inflate *z)
+{
+	int flg, n;
+
+	/* more members may follow, anything else after the first is ignored */
+	if (z->members && ((!z->nbits && !refill(z)) || (z->bits & 0xff) != 0x1f)) {
+		z->state = END;
+		return;
+	}
+	if (getbits(z, 8) != 0x1f || getbits(z, 8) != 0x8b || getbits(z, 8) != 8)
+		eprintf("inflate: not in gzip format\n");
+	flg = getbits(z, 8);
+	getbits(z, 16), getbits(z, 16), getbits(z, 16);
+	if (flg & 4)
+		for (n = getbits(z, 16); n; n--)
+			getbits(z, 8);
+	if (flg & 8)
+		while (getbits(z, 8))
+			;
+	if (flg & 16)
+		while (getbits(z, 8))
+			;
+	if (flg & 2)
+		getbits(z, 16);
+	z->members++;
+	z->crc = z->isize = 0;
+	z->have = 0;
+	z->last = 0;
+	z->state = BLOCK;
+}
+
+/* decompress some more into the window, 0 at the end */
+static int
+step(struct inflate *z)
+{
+	size_t start = z->wpos, n, len, dist;
+	uint32_t crc, isize;
+	int s, type;
+
+	switch (z->state) {
+	case HEADER:
+		header(z);
+		return z->state != END;
+	case BLOCK:
+		if (z->last) {
+			z->state = TRAILER;
+			return 1;
+		}
+		z->last = getbits(z, 1);
+		switch ((type = getbits(z, 2))) {
+		case 0:
+			getbits(z, z->nbits & 7);
+			z->stored = getbits(z, 16);
+			if ((getbits(z, 16) ^ 0xffff) != z->stored)
+				corrupt();
+			z->state = STORED;
+			break;
+		case 1:
+		case 2:
+			tables(z, type);
+			z->state = HUFF;
+			break;
+		default:
+			corrupt();
+		}
+		return 1;
+	case STORED:
+		while (z->stored && z->avail < WINSIZ - HIST) {
+			if (z->nbits || z->inoff == z->inlen) {
+				put(z, getbits(z, 8));
+				z->stored--;
+				continue;
+			}
+			/* straight from the input */
+			n = MIN(MIN(z->stored, z->inlen - z->inoff), WINSIZ - HIST - z->avail);
+			n = MIN(n, WINSIZ - (z->wpos & (WINSIZ - 1)));
+			memcpy(z->win + (z->wpos & (WINSIZ - 1)), z->in + z->inoff, n);
+			z->inoff += n;
+			z->wpos += n;
+			z->avail += n;
+			z->stored -= n;
+		}
+		if (!z->stored)
+			z->state = BLOCK;
+		break;
+	case HUFF:
+		while (z->avail <= WINSIZ - HIST - MAXMATCH) {
+			s = decode(z, z->lcount, z->lsym, z->ltab);
+			if (s < 256) {
+				put(z, s);
+				continue;
+			}
+			if (s == 256) {
+				z->state = BLOCK;
+				break;
+			}
+			if ((s -= 257) >= 29)
+				corrupt();
+			len = lbase[s] + getbits(z, lext[s]);
+			if ((s = decode(z, z->dcount, z->dsym, z->dtab)) >= 30)
+				corrupt();
+			dist = dbase[s] + getbits(z, dext[s]);
+			if (dist > z->have + (z->wpos - start))
+				corrupt();
+			for (; len; len--)
+				put(z, z->win[(z->wpos - dist) & (WINSIZ - 1)]);
+		}
+		break;
+	case TRAILER:
+		getbits(z, z->nbits & 7);
+		crc = getbits(z, 16);
+		crc |= getbits(z, 16) << 16;
+		isize = getbits(z, 16);
+		isize |= getbits(z, 16) << 16;
+		if (crc != z->crc || isize != z->isize)
+			eprintf("inflate: crc error\n");
+		z->state = HEADER;
+		return 1;
+	case END:
+		return 0;
+	}
+
+	/* check what was added, it is still in the window */
+	for (; start != z->wpos; start += n) {
+		n = MIN(z->wpos - start, WINSIZ - (start & (WINSIZ - 1)));
+		z->crc = crc32(z->crc, z->win + (start & (WINSIZ - 1)), n);
+		z->isize += n;
+		z->have = MIN(z->have + n, HIST);
+	}
+	return 1;
+}
+
+void
+inflate_init(struct inflate *z, int fd)
+{
+	memset(z, 0, sizeof(*z));
+	z->fd = fd;
+	z->in = emalloc(INSIZ);
+	z->win = emalloc(WINSIZ);
+	z->state = HEADER;
+}
+
+size_t
+inflate_read(struct inflate *z, void *buf, size_t n)
+{
+	uint8_t *p = buf;
+	size_t done = 0, k, off;
+
+	while (done < n) {
+		if (!z->avail) {
+			if (!step(z))
+				break;
+			continue;
+		}
+		off = (z->wpos - z->avail) & (WINSIZ - 1);
+		k = MIN(MIN(z->avail, n - done), WINSIZ - off);
+		memcpy(p + done, z->win + off, k);
+		z->avail -= k;
+		done += k;
+	}
+	return done;
+}
@@ -58,9 +58,13 @@ memmem(const void *l, size_t l_len, const void *s, size_t s_len)
 	/* the last position where its possible to find "s" in "l" */
 	last = cl + l_len - s_len;
 
-	for (cur = cl; cur <= last; cur++)
-		if (cur[0] == cs[0] && memcmp(cur, cs, s_len) == 0)
+	/* let memchr skip ahead to each candidate first byte */
+	for (cur = cl; cur <= last; cur++) {
+		if (!(cur = memchr(cur, cs[0], last - cur + 1)))
+			break;
+		if (memcmp(cur + 1, cs + 1, s_len - 1) == 0)
 			return (void *)cur;
+	}
 
 	return NULL;
 }
@@ -4,20 +4,22 @@
 
 #include "../sha1.h"
 
-static uint32_t rol(uint32_t n, int k) { return (n << k) | (n >> (32-k)); }
+#define rol(n,k) ((n) << (k) | (n) >> (32-(k)))
 #define F0(b,c,d) (d ^ (b & (c ^ d)))
 #define F1(b,c,d) (b ^ c ^ d)
 #define F2(b,c,d) ((b & c) | (d & (b | c)))
 #define F3(b,c,d) (b ^ c ^ d)
-#define G0(a,b,c,d,e,i) e += rol(a,5)+F0(b,c,d)+W[i]+0x5A827999; b = rol(b,30)
-#define G1(a,b,c,d,e,i) e += rol(a,5)+F1(b,c,d)+W[i]+0x6ED9EBA1; b = rol(b,30)
-#define G2(a,b,c,d,e,i) e += rol(a,5)+F2(b,c,d)+W[i]+0x8F1BBCDC; b = rol(b,30)
-#define G3(a,b,c,d,e,i) e += rol(a,5)+F3(b,c,d)+W[i]+0xCA62C1D6; b = rol(b,30)
+/* the message schedule is kept to 16 words, each computed as it is needed */
+#define W(i) ((i) < 16 ? W[i] : (W[(i)&15] = rol(W[((i)+13)&15] ^ W[((i)+8)&15] ^ W[((i)+2)&15] ^ W[(i)&15], 1)))
+#define G0(a,b,c,d,e,i) e += rol(a,5)+F0(b,c,d)+W(i)+0x5A827999; b = rol(b,30)
+#define G1(a,b,c,d,e,i) e += rol(a,5)+F1(b,c,d)+W(i)+0x6ED9EBA1; b = rol(b,30)
+#define G2(a,b,c,d,e,i) e += rol(a,5)+F2(b,c,d)+W(i)+0x8F1BBCDC; b = rol(b,30)
+#define G3(a,b,c,d,e,i) e += rol(a,5)+F3(b,c,d)+W(i)+0xCA62C1D6; b = rol(b,30)
 
 static void
 processblock(struct sha1 *s, const uint8_t *buf)
 {
-	uint32_t W[80], a, b, c, d, e;
+	uint32_t W[16], a, b, c, d, e;
 	int i;
 
 	for (i = 0; i < 16; i++) {
@@ -26,40 +28,38 @@ processblock(struct sha1 *s, const uint8_t *buf)
 		W[i] |= (uint32_t)buf[4*i+2]<<8;
 		W[i] |= buf[4*i+3];
 	}
-	for (; i < 80; i++)
-		W[i] = rol(W[i-3] ^ W[i-8] ^ W[i-14] ^ W[i-16], 1);
 	a = s->h[0];
 	b = s->h[1];
 	c = s->h[2];
 	d = s->h[3];
 	e = s->h[4];
-	for (i = 0; i < 20; ) {
-		G0(a,b,c,d,e,i++);
-		G0(e,a,b,c,d,i++);
-		G0(d,e,a,b,c,i++);
-		G0(c,d,e,a,b,i++);
-		G0(b,c,d,e,a,i++);
+	for (i = 0; i < 20; i += 5) {
+		G0(a,b,c,d,e,i);
+		G0(e,a,b,c,d,i+1);
+		G0(d,e,a,b,c,i+2);
+		G0(c,d,e,a,b,i+3);
+		G0(b,c,d,e,a,i+4);
 	}
-	while (i < 40) {
-		G1(a,b,c,d,e,i++);
-		G1(e,a,b,c,d,i++);
-		G1(d,e,a,b,c,i++);
-		G1(c,d,e,a,b,i++);
-		G1(b,c,d,e,a,i++);
+	for (; i < 40; i += 5) {
+		G1(a,b,c,d,e,i);
+		G1(e,a,b,c,d,i+1);
+		G1(d,e,a,b,c,i+2);
+		G1(c,d,e,a,b,i+3);
+		G1(b,c,d,e,a,i+4);
 	}
-	while (i < 60) {
-		G2(a,b,c,d,e,i++);
-		G2(e,a,b,c,d,i++);
-		G2(d,e,a,b,c,i++);
-		G2(c,d,e,a,b,i++);
-		G2(b,c,d,e,a,i++);
+	for (; i < 60; i += 5) {
+		G2(a,b,c,d,e,i);
+		G2(e,a,b,c,d,i+1);
+		G2(d,e,a,b,c,i+2);
+		G2(c,d,e,a,b,i+3);
+		G2(b,c,d,e,a,i+4);
 	}
-	while (i < 80) {
-		G3(a,b,c,d,e,i++);
-		G3(e,a,b,c,d,i++);
-		G3(d,e,a,b,c,i++);
-		G3(c,d,e,a,b,i++);
-		G3(b,c,d,e,a,i++);
+	for (; i < 80; i += 5) {
+		G3(a,b,c,d,e,i);
+		G3(e,a,b,c,d,i+1);
+		G3(d,e,a,b,c,i+2);
+		G3(c,d,e,a,b,i+3);
+		G3(b,c,d,e,a,i+4);
 	}
 	s->h[0] += a;
 	s->h[1] += b;
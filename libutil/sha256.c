@@ -7,13 +7,17 @@
 
 #include "../sha256.h"
 
-static uint32_t ror(uint32_t n, int k) { return (n >> k) | (n << (32-k)); }
+#define ror(n,k)   ((n) >> (k) | (n) << (32-(k)))
 #define Ch(x,y,z)  (z ^ (x & (y ^ z)))
 #define Maj(x,y,z) ((x & y) | (z & (x | y)))
 #define S0(x)      (ror(x,2) ^ ror(x,13) ^ ror(x,22))
 #define S1(x)      (ror(x,6) ^ ror(x,11) ^ ror(x,25))
 #define R0(x)      (ror(x,7) ^ ror(x,18) ^ (x>>3))
 #define R1(x)      (ror(x,17) ^ ror(x,19) ^ (x>>10))
+#define G(a,b,c,d,e,f,g,h,i) \
+	t1 = h + S1(e) + Ch(e,f,g) + K[i] + W[i]; \
+	d += t1; \
+	h = t1 + S0(a) + Maj(a,b,c)
 
 static const uint32_t K[64] = {
 0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
@@ -29,7 +33,7 @@ static const uint32_t K[64] = {
 static void
 processblock(struct sha256 *s, const uint8_t *buf)
 {
-	uint32_t W[64], t1, t2, a, b, c, d, e, f, g, h;
+	uint32_t W[64], t1, a, b, c, d, e, f, g, h;
 	int i;
 
 	for (i = 0; i < 16; i++) {
@@ -48,17 +52,16 @@ processblock(struct sha256 *s, const uint8_t *buf)
 	f = s->h[5];
 	g = s->h[6];
 	h = s->h[7];
-	for (i = 0; i < 64; i++) {
-		t1 = h + S1(e) + Ch(e,f,g) + K[i] + W[i];
-		t2 = S0(a) + Maj(a,b,c);
-		h = g;
-		g = f;
-		f = e;
-		e = d + t1;
-		d = c;
-		c = b;
-		b = a;
-		a = t1 + t2;
+	/* the variables take turns instead of being shifted along */
+	for (i = 0; i < 64; i += 8) {
+		G(a,b,c,d,e,f,g,h,i);
+		G(h,a,b,c,d,e,f,g,i+1);
+		G(g,h,a,b,c,d,e,f,i+2);
+		G(f,g,h,a,b,c,d,e,i+3);
+		G(e,f,g,h,a,b,c,d,i+4);
+		G(d,e,f,g,h,a,b,c,i+5);
+		G(c,d,e,f,g,h,a,b,i+6);
+		G(b,c,d,e,f,g,h,a,i+7);
 	}
 	s->h[0] += a;
 	s->h[1] += b;
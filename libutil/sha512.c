@@ -8,13 +8,17 @@
 
 #include "../sha512.h"
 
-static uint64_t ror(uint64_t n, int k) { return (n >> k) | (n << (64-k)); }
+#define ror(n,k)   ((n) >> (k) | (n) << (64-(k)))
 #define Ch(x,y,z)  (z ^ (x & (y ^ z)))
 #define Maj(x,y,z) ((x & y) | (z & (x | y)))
 #define S0(x)      (ror(x,28) ^ ror(x,34) ^ ror(x,39))
 #define S1(x)      (ror(x,14) ^ ror(x,18) ^ ror(x,41))
 #define R0(x)      (ror(x,1) ^ ror(x,8) ^ (x>>7))
 #define R1(x)      (ror(x,19) ^ ror(x,61) ^ (x>>6))
+#define G(a,b,c,d,e,f,g,h,i) \
+	t1 = h + S1(e) + Ch(e,f,g) + K[i] + W[i]; \
+	d += t1; \
+	h = t1 + S0(a) + Maj(a,b,c)
 
 static const uint64_t K[80] = {
 0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
@@ -42,7 +46,7 @@ static const uint64_t K[80] = {
 static void
 processblock(struct sha512 *s, const uint8_t *buf)
 {
-	uint64_t W[80], t1, t2, a, b, c, d, e, f, g, h;
+	uint64_t W[80], t1, a, b, c, d, e, f, g, h;
 	int i;
 
 	for (i = 0; i < 16; i++) {
@@ -65,17 +69,16 @@ processblock(struct sha512 *s, const uint8_t *buf)
 	f = s->h[5];
 	g = s->h[6];
 	h = s->h[7];
-	for (i = 0; i < 80; i++) {
-		t1 = h + S1(e) + Ch(e,f,g) + K[i] + W[i];
-		t2 = S0(a) + Maj(a,b,c);
-		h = g;
-		g = f;
-		f = e;
-		e = d + t1;
-		d = c;
-		c = b;
-		b = a;
-		a = t1 + t2;
+	/* the variables take turns instead of being shifted along */
+	for (i = 0; i < 80; i += 8) {
+		G(a,b,c,d,e,f,g,h,i);
+		G(h,a,b,c,d,e,f,g,i+1);
+		G(g,h,a,b,c,d,e,f,i+2);
+		G(f,g,h,a,b,c,d,e,i+3);
+		G(e,f,g,h,a,b,c,d,i+4);
+		G(d,e,f,g,h,a,b,c,i+5);
+		G(c,d,e,f,g,h,a,b,i+6);
+		G(b,c,d,e,f,g,h,a,i+7);
 	}
 	s->h[0] += a;
 	s->h[1] += b;
@@ -7,7 +7,10 @@
 #include <ctype.h>
 #include <errno.h>
 #include <stdint.h>
+#include <limits.h>
+#include <poll.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 
 #include "text.h"
 #include "util.h"
@@ -87,13 +90,23 @@ struct line_data {
 	char new;
 	char orig;
 	size_t nold;
+	size_t hash; /* 0 until computed */
 	struct line line;
 	struct line *old;
 };
 
 struct file_data {
+	/* n lines and the one past the end, with gapn unused
+	 * elements before line gap while hunks are applied */
 	struct line_data *d;
 	size_t n;
+	size_t gap;
+	size_t gapn;
+	/* lines by hash, bucket[h] and chain[i] are 1 + the position of the
+	 * next line, 0 for none. nbuckets is 0 when d has changed */
+	size_t *bucket;
+	size_t *chain;
+	size_t nbuckets;
 };
 
 struct patched_file {
@@ -114,8 +127,10 @@ static int lflag = 0;
 static int Rflag = 0;
 static int Nflag = 0;
 static int Uflag = 0;
+static int jflag = 1;
 static char *dflag = 0;
 static int rejected = 0;
+static int know_direction = 0;
 static struct patched_file *prevpatch = 0;
 static size_t prevpatchn = 0;
 static struct patched_file *prevout = 0;
@@ -128,8 +143,8 @@ static char *ifndef = 0;
 static void
 usage(void)
 {
-	enprintf(FAILURE, "usage: %s [-c | -e | -n | -u] [-d dir] [-D define] [-o outfile] [-p num] "
-		 "[-r rejectfile] [-bflNRU] (-i patchfile | < patchfile) [file]\n", argv0);
+	enprintf(FAILURE, "usage: %s [-c | -e | -n | -u] [-d dir] [-D define] [-j jobs] [-o outfile] "
+		 "[-p num] [-r rejectfile] [-bflNRU] (-i patchfile | < patchfile) [file]\n", argv0);
 }
 
 static void
@@ -146,6 +161,10 @@ load_lines(const char *path, struct file_data *out, int skip_lf, int orig)
 
 	out->n = n = b.nlines;
 	out->d = encalloc(FAILURE, n + 1, sizeof(*out->d));
+	out->gap = n + 1;
+	out->gapn = 0;
+	out->bucket = out->chain = 0;
+	out->nbuckets = 0;
 	for (i = 0; i < n; i++) {
 		out->d[i].line = b.lines[i];
 		out->d[i].orig = orig;
@@ -1311,17 +1330,144 @@ linecmpw(struct line *al, struct line *bl)
 	return a == ae ? b == be ? 0 : -1 : 1;
 }
 
+static struct line_data *
+lineat(struct file_data *f, size_t i)
+{
+	return f->d + (i < f->gap ? i : i + f->gapn);
+}
+
+static void
+movegap(struct file_data *f, size_t to)
+{
+	if (to < f->gap)
+		memmove(f->d + to + f->gapn, f->d + to, (f->gap - to) * sizeof(*f->d));
+	else
+		memmove(f->d + f->gap, f->d + f->gap + f->gapn, (to - f->gap) * sizeof(*f->d));
+	f->gap = to;
+}
+
 static int
 does_hunk_match(struct file_data *file, size_t position, struct hunk_content *hunk)
 {
 	size_t pos, n = hunk->len;
 	while (n)
 		if (pos = position + --n, pos >= file->n ||
-		    (lflag ? linecmpw : linecmp)(&file->d[pos].line, hunk->lines + n))
+		    (lflag ? linecmpw : linecmp)(&lineat(file, pos)->line, hunk->lines + n))
 			return 0;
 	return 1;
 }
 
+static size_t
+linehash(struct line *l)
+{
+	const unsigned char *s = (const unsigned char *)(l->data), *e = s + l->len;
+	size_t h = 2166136261UL;
+	int space = 0;
+
+	if (!lflag) {
+		for (; s != e; s++)
+			h = (h ^ *s) * 16777619UL;
+		return h | 1;
+	}
+
+	/* equal to linecmpw: ignore leading and trailing whitespace,
+	 * any run of whitespace between words is the same */
+	for (; s != e && isspace(*s); s++);
+	for (; s != e; s++) {
+		if (isspace(*s)) {
+			space = 1;
+			continue;
+		}
+		if (space)
+			h = (h ^ ' ') * 16777619UL;
+		h = (h ^ *s) * 16777619UL;
+		space = 0;
+	}
+	return h | 1;
+}
+
+static void
+index_lines(struct file_data *f)
+{
+	struct line_data *d;
+	size_t i, h, nb;
+
+	for (nb = 1; nb < f->n; nb <<= 1);
+	f->bucket = enrealloc(FAILURE, f->bucket, nb * sizeof(*f->bucket));
+	f->chain = enrealloc(FAILURE, f->chain, (f->n + 1) * sizeof(*f->chain));
+	memset(f->bucket, 0, nb * sizeof(*f->bucket));
+
+	/* backwards, so each chain is in ascending order */
+	for (i = f->n; i--;) {
+		d = lineat(f, i);
+		if (!d->hash)
+			d->hash = linehash(&d->line);
+		h = d->hash & (nb - 1);
+		f->chain[i] = f->bucket[h];
+		f->bucket[h] = i + 1;
+	}
+	f->nbuckets = nb;
+}
+
+static ssize_t
+find_hunk(struct file_data *f, ssize_t pos, struct hunk_content *hunk)
+{
+	static size_t *cand = 0, candsiz = 0;
+	size_t i, k = 0, h, hk = 0, p, cnt, best = SIZE_MAX, ncand = 0, fw, bw;
+	ssize_t dist, near;
+
+	/* nothing to compare, matches where it is */
+	if (!hunk->len)
+		return pos;
+
+	/* the index is rebuilt after every edit, so first look close by,
+	 * which is cheap as most lines differ on the first byte */
+	near = f->nbuckets ? 0 : f->n / 32;
+	for (dist = 0; dist <= near; dist++) {
+		if (pos + dist < (ssize_t)f->n && does_hunk_match(f, pos + dist, hunk))
+			return pos + dist;
+		if (dist && pos - dist >= 0 && does_hunk_match(f, pos - dist, hunk))
+			return pos - dist;
+	}
+
+	if (!f->nbuckets)
+		index_lines(f);
+
+	/* look up the hunk line with the fewest equal lines in the file */
+	for (i = 0; i < hunk->len && best; i++) {
+		h = linehash(hunk->lines + i);
+		cnt = 0;
+		for (p = f->bucket[h & (f->nbuckets - 1)]; p && cnt < best; p = f->chain[p - 1])
+			cnt += lineat(f, p - 1)->hash == h;
+		if (cnt < best) {
+			best = cnt;
+			k = i;
+			hk = h;
+		}
+	}
+
+	/* each occurrence of it, at or after line k, is where the hunk might start */
+	for (p = f->bucket[hk & (f->nbuckets - 1)]; best && p; p = f->chain[p - 1]) {
+		if (lineat(f, p - 1)->hash != hk || p - 1 < k)
+			continue;
+		if (ncand == candsiz)
+			cand = enrealloc(FAILURE, cand, (candsiz = candsiz * 2 + 16) * sizeof(*cand));
+		cand[ncand++] = p - 1 - k;
+	}
+
+	/* try them nearest first, the later one when two are as near */
+	for (fw = 0; fw < ncand && (ssize_t)cand[fw] < pos; fw++);
+	for (bw = fw; fw < ncand || bw;) {
+		if (fw < ncand && (!bw || (ssize_t)cand[fw] - pos <= pos - (ssize_t)cand[bw - 1]))
+			p = cand[fw++];
+		else
+			p = cand[--bw];
+		if (does_hunk_match(f, p, hunk))
+			return p;
+	}
+	return -1;
+}
+
 static void
 linedup(struct line *restrict dest, const struct line *restrict src)
 {
@@ -1333,26 +1479,35 @@ linedup(struct line *restrict dest, const struct line *restrict src)
 static void
 apply_contiguous_edit(struct file_data *f, size_t ln, size_t rm, size_t ad, struct line *newlines, const char *annot)
 {
-#define LN  (f->d[ln])
+#define LN  (*lineat(f, ln))
 
-	size_t rm_end, ad_end, n, a, b, start, extra, i, j, k;
+	size_t n, a, b, start, extra, i, j, k;
 	struct line_data *orig;
 
-	rm_end = ln + rm;
-	ad_end = ln + ad;
-	n = f->n;
-
-	orig = enmemdup(FAILURE, f->d + ln, (rm + 1) * sizeof(*f->d));
-	memmove(f->d + ln, f->d + rm_end, (n - rm_end + 1) * sizeof(*f->d));
+	f->nbuckets = 0;
 
+	/* removed lines join the gap, added lines are taken from it,
+	 * so only the lines between this edit and the last one move */
+	movegap(f, ln);
+	orig = enmemdup(FAILURE, f->d + ln + f->gapn, (rm + 1) * sizeof(*f->d));
+	f->gapn += rm;
 	f->n -= rm;
-	if (f->n == 1 && !*(f->d->line.data))
-		f->n--, n--;
-	f->n += ad;
+	if (f->n == 1 && !*(lineat(f, 0)->line.data)) {
+		memmove(f->d + ln + f->gapn + 1, f->d + ln + f->gapn, (f->n - ln) * sizeof(*f->d));
+		f->gapn++;
+		f->n--;
+	}
 
-	f->d = enrealloc(FAILURE, f->d, (f->n + 1) * sizeof(*f->d));
-	memmove(f->d + ad_end, f->d + ln, (n - rm_end + 1) * sizeof(*f->d));
+	if (f->gapn < ad) {
+		n = f->gapn;
+		f->gapn = f->n + 1 + ad * 2;
+		f->d = enrealloc(FAILURE, f->d, (f->n + 1 + f->gapn) * sizeof(*f->d));
+		memmove(f->d + ln + f->gapn, f->d + ln + n, (f->n + 1 - ln) * sizeof(*f->d));
+	}
 	memset(f->d + ln, 0, ad * sizeof(*f->d));
+	f->gap += ad;
+	f->gapn -= ad;
+	f->n += ad;
 
 	for (i = a = b = 0; a < rm || b < ad; ln++) {
 		for (start = i, extra = 0; a < rm && strchr("<-", annot[i]); a++, i++)
@@ -1414,8 +1569,7 @@ apply_hunk_try(struct file_data *file, struct parsed_hunk *fhunk, ssize_t offset
                int reverse, int dryrun, ssize_t *fuzz)
 {
 	struct parsed_hunk hunk;
-	ssize_t pos, dist = 0;
-	int finbounds, binbounds;
+	ssize_t pos, found;
 
 	hunk = *fhunk;
 	if (reverse)
@@ -1429,29 +1583,16 @@ apply_hunk_try(struct file_data *file, struct parsed_hunk *fhunk, ssize_t offset
 		pos = 0;
 	if ((size_t)pos > file->n)
 		pos = file->n;
-	for (dist = 0;; dist++) {
-		finbounds = pos + dist < file->n;
-		binbounds = pos - dist >= 0;
-		if (finbounds && does_hunk_match(file, pos + dist, &hunk.old)) {
-			pos += *fuzz = +dist;
-			goto found;
-		} else if (binbounds && does_hunk_match(file, pos - dist, &hunk.old)) {
-			pos += *fuzz = -dist;
-			goto found;
-		} else if (!finbounds && !binbounds) {
-			break;
-		}
+	if ((found = find_hunk(file, pos, &hunk.old)) >= 0) {
+		*fuzz = found - pos;
+		pos = found;
+		goto found;
 	}
 
 	pos = (ssize_t)(hunk.new.start) + offset;
-	for (dist = 0;; dist++) {
-		finbounds = pos + dist < file->n;
-		binbounds = pos - dist >= 0;
-		if ((finbounds && does_hunk_match(file, pos + (*fuzz = +dist), &hunk.new)) ||
-		    (binbounds && does_hunk_match(file, pos + (*fuzz = -dist), &hunk.new)))
-			return APPLIED;
-		else if (!finbounds && !binbounds)
-			break;
+	if ((found = find_hunk(file, pos, &hunk.new)) >= 0) {
+		*fuzz = found - pos;
+		return APPLIED;
 	}
 
 	return INAPPLICABLE;
@@ -1465,7 +1606,6 @@ found:
 static enum applicability
 apply_hunk(struct file_data *file, struct parsed_hunk *hunk, ssize_t offset, ssize_t *fuzz, int forward)
 {
-	static int know_direction = 0;
 	int rev = forward ? 0 : Rflag;
 	enum applicability fstatus, rstatus;
 
@@ -1686,6 +1826,7 @@ apply_patch(struct patch *patch, size_t patch_index)
 		free(hunk.annot);
 		free(hunk.rannot);
 	}
+	movegap(file, file->n + 1);
 	free(patch->hunks);
 	if (!rejectfile)
 		free(rejfile);
@@ -1699,16 +1840,269 @@ apply_patch(struct patch *patch, size_t patch_index)
 		for (i = 0; i < file->n; i++)
 			free(file->d[i].line.data);
 		free(file->d);
+		free(file->bucket);
+		free(file->chain);
 		free(file);
 	}
 }
 
+struct job {
+	pid_t pid;
+	int cmd, res;  /* pipes to hand it groups and get its results */
+	FILE *log;     /* its stderr */
+	off_t off;     /* where its messages for the next patch start */
+	size_t next;   /* the next patch it applies */
+	size_t left;   /* patches left in its group */
+};
+
+struct result {
+	size_t patch;
+	off_t end;     /* where its messages end in the log */
+};
+
+static void
+writeall(int fd, const void *buf, size_t n)
+{
+	const char *p = buf;
+	ssize_t r;
+
+	for (; n; n -= r, p += r)
+		if ((r = write(fd, p, n)) < 0 && errno != EINTR)
+			enprintf(FAILURE, "write:");
+		else if (r < 0)
+			r = 0;
+}
+
+static int
+readall(int fd, void *buf, size_t n)
+{
+	char *p = buf;
+	ssize_t r;
+
+	for (; n; n -= r, p += r)
+		if ((r = read(fd, p, n)) < 0 && errno != EINTR)
+			enprintf(FAILURE, "read:");
+		else if (!r)
+			return -1;
+		else if (r < 0)
+			r = 0;
+	return 0;
+}
+
+static size_t
+next_in_group(size_t *group, size_t n, size_t i)
+{
+	size_t j;
+
+	for (j = i + 1; j < n && group[j] != group[i]; j++);
+	return j;
+}
+
+/* apply the patches of each group read from cmd, report each one to res */
+static void
+run_job(struct patchset *ps, size_t *group, int cmd, int res)
+{
+	struct result r;
+	size_t i, lead;
+
+	memset(&r, 0, sizeof(r));
+	while (!readall(cmd, &lead, sizeof(lead))) {
+		for (i = lead; i < ps->npatches; i = next_in_group(group, ps->npatches, i)) {
+			apply_patch(ps->patches + i, i);
+			r.patch = i;
+			if ((r.end = lseek(2, 0, SEEK_CUR)) < 0)
+				enprintf(FAILURE, "lseek:");
+			writeall(res, &r, sizeof(r));
+		}
+	}
+	exit(rejected ? REJECTED : 0);
+}
+
+static void
+give_group(struct job *job, size_t lead, size_t *count)
+{
+	writeall(job->cmd, &lead, sizeof(lead));
+	job->next = lead;
+	job->left = count[lead];
+}
+
+/* keep what the job wrote for its current patch, up to end */
+static void
+save_messages(struct job *job, off_t end, char **msg, size_t *msglen)
+{
+	size_t i = job->next;
+	ssize_t r;
+
+	msglen[i] = end - job->off;
+	msg[i] = enmalloc(FAILURE, msglen[i] + 1);
+	if ((r = pread(fileno(job->log), msg[i], msglen[i], job->off)) < 0)
+		enprintf(FAILURE, "pread:");
+	msglen[i] = r;
+	job->off = end;
+}
+
+static void
+apply_patches_parallel(struct patchset *ps, size_t first)
+{
+	struct stat *attr, st;
+	struct job *jobs, *job;
+	struct pollfd *pfd;
+	struct result r;
+	size_t i, j, k, *group, *count, *lead, nlead = 0, nextlead = 0, out = first;
+	size_t n = ps->npatches, njobs, active, *msglen;
+	int failed = 0, status, fds[2], cmd[2];
+	char *exists, *done, **msg;
+
+	attr = enmalloc(FAILURE, n * sizeof(*attr));
+	exists = enmalloc(FAILURE, n);
+	group = enmalloc(FAILURE, n * sizeof(*group));
+	count = encalloc(FAILURE, n, sizeof(*count));
+	lead = enmalloc(FAILURE, n * sizeof(*lead));
+	done = encalloc(FAILURE, n, 1);
+	msg = encalloc(FAILURE, n, sizeof(*msg));
+	msglen = encalloc(FAILURE, n, sizeof(*msglen));
+
+	/* group[i] is the first patch to the same file as patch i */
+	for (i = first; i < n; i++) {
+		exists[i] = !stat(PATH(ps->patches[i].path), attr + i);
+		for (group[i] = first; group[i] < i; group[i]++) {
+			j = group[i];
+			if (exists[i] && exists[j] ? issamefile(attr[i], attr[j]) :
+			    !strcmp(ps->patches[i].path, ps->patches[j].path))
+				break;
+		}
+		if (group[i] == i)
+			lead[nlead++] = i;
+		else
+			group[i] = group[group[i]];
+		count[group[i]]++;
+	}
+
+	/*
+	 * a free job gets the next group, every group is applied in patch
+	 * order. a job's stderr is a file of its own, so its messages can be
+	 * printed by patch once those of the patches before are
+	 */
+	njobs = MIN((size_t)jflag, nlead);
+	jobs = encalloc(FAILURE, njobs, sizeof(*jobs));
+	pfd = enmalloc(FAILURE, njobs * sizeof(*pfd));
+	fflush(stdout);
+	fflush(stderr);
+	for (k = 0; k < njobs; k++) {
+		job = jobs + k;
+		if (!(job->log = tmpfile()))
+			enprintf(FAILURE, "tmpfile:");
+		if (pipe(fds) < 0 || pipe(cmd) < 0)
+			enprintf(FAILURE, "pipe:");
+		switch ((job->pid = fork())) {
+		case -1:
+			enprintf(FAILURE, "fork:");
+		case 0:
+			if (dup2(fileno(job->log), 2) < 0)
+				enprintf(FAILURE, "dup2:");
+			close(fds[0]);
+			close(cmd[1]);
+			for (j = 0; j < k; j++) {
+				close(jobs[j].cmd);
+				close(jobs[j].res);
+			}
+			run_job(ps, group, cmd[0], fds[1]);
+		}
+		close(fds[1]);
+		close(cmd[0]);
+		job->res = fds[0];
+		job->cmd = cmd[1];
+		give_group(job, lead[nextlead++], count);
+	}
+
+	for (active = njobs; active;) {
+		for (k = j = 0; k < njobs; k++) {
+			if (jobs[k].res < 0)
+				continue;
+			pfd[j].fd = jobs[k].res;
+			pfd[j++].events = POLLIN;
+		}
+		if (poll(pfd, j, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			enprintf(FAILURE, "poll:");
+		}
+		for (k = j = 0; k < njobs; k++) {
+			job = jobs + k;
+			if (job->res < 0 || !pfd[j++].revents)
+				continue;
+			if (!readall(job->res, &r, sizeof(r)) && job->left) {
+				save_messages(job, r.end, msg, msglen);
+				done[job->next] = 1;
+				job->next = next_in_group(group, n, job->next);
+				if (--job->left)
+					continue;
+				if (nextlead < nlead && !failed) {
+					give_group(job, lead[nextlead++], count);
+				} else {
+					close(job->cmd);
+					job->cmd = -1;
+				}
+				continue;
+			}
+			/* the job is gone, maybe while applying a patch */
+			if (job->left) {
+				if (fstat(fileno(job->log), &st) < 0)
+					enprintf(FAILURE, "fstat:");
+				save_messages(job, st.st_size, msg, msglen);
+				for (; job->left--; job->next = next_in_group(group, n, job->next))
+					done[job->next] = 1;
+				failed = 1;
+			}
+			close(job->res);
+			job->res = -1;
+			if (job->cmd >= 0)
+				close(job->cmd);
+			job->cmd = -1;
+			active--;
+		}
+		/* messages are passed on in patch order */
+		for (; out < n && done[out]; out++) {
+			fwrite(msg[out], 1, msglen[out], stderr);
+			free(msg[out]);
+		}
+	}
+
+	for (k = 0; k < njobs; k++) {
+		if (waitpid(jobs[k].pid, &status, 0) < 0)
+			enprintf(FAILURE, "waitpid:");
+		status = WIFEXITED(status) ? WEXITSTATUS(status) : FAILURE;
+		rejected |= status == REJECTED;
+		failed |= status != REJECTED && status;
+		fclose(jobs[k].log);
+	}
+	if (failed)
+		exit(FAILURE);
+
+	free(attr);
+	free(exists);
+	free(group);
+	free(count);
+	free(lead);
+	free(done);
+	free(msg);
+	free(msglen);
+	free(jobs);
+	free(pfd);
+}
+
 static void
 apply_patchset(struct patchset *ps)
 {
 	size_t i = 0;
-	for (i = 0; i < ps->npatches; i++)
+	int parallel = jflag > 1 && !outfile && !ifdef && !rejectfile;
+
+	/* whether -R is assumed is decided at the first hunk that
+	 * applies either way, so patches up to it are applied here */
+	for (i = 0; i < ps->npatches && !(parallel && know_direction); i++)
 		apply_patch(ps->patches + i, i);
+	if (i < ps->npatches)
+		apply_patches_parallel(ps, i);
 	free(ps->patches);
 }
 
@@ -1760,6 +2154,9 @@ main(int argc, char *argv[])
 		if (!strcmp(patchfile, "-"))
 			patchfile = stdin_dash;
 		break;
+	case 'j':
+		jflag = enstrtonum(FAILURE, EARGF(usage()), 1, INT_MAX);
+		break;
 	case 'l':
 		lflag = 1;
 		break;
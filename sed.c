@@ -7,11 +7,15 @@
  * POSIX says don't flush on N when out of input, but GNU and busybox do.
  */
 
+#include <sys/stat.h>
+
 #include <ctype.h>
 #include <errno.h>
+#include <limits.h>
 #include <regex.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "utf.h"
 #include "util.h"
@@ -42,10 +46,22 @@ typedef struct {
 	unsigned char naddr;
 } Fninfo;
 
+/* regex address, shared by all addresses using the same regex so it only
+ * has to be matched once for each pattern space
+ */
+typedef struct {
+	regex_t       re;
+	char         *str;   /* regex as written */
+	char         *lit;   /* str if it has no special characters */
+	unsigned int  E:1;   /* compiled as extended re */
+	unsigned int  match:1;
+	size_t        gen;   /* pattgen that match is for */
+} Raddr;
+
 typedef struct {
 	union {
 		size_t   lineno;
-		regex_t *re;
+		Raddr   *ra;
 	} u;
 	enum {
 		IGNORE, /* empty address, ignore        */
@@ -68,9 +84,19 @@ typedef struct {
 	unsigned char naddr;
 } Range;
 
+/* replacement text of s split at & and back-references */
+typedef struct {
+	char  *str; /* literal text, NULL for & and back-references */
+	size_t len; /* length of str, else number of back-reference (0 for &) */
+} Rpart;
+
 typedef struct {
 	regex_t      *re; /* if NULL use last regex */
+	char         *lit; /* re as a string if it has no special characters */
+	size_t        litlen;
 	String        repl;
+	Rpart        *parts;
+	size_t        nparts;
 	FILE         *file;
 	size_t        occurrence; /* 0 for all (g flag) */
 	Rune          delim;
@@ -105,6 +131,13 @@ struct Cmd {
 	unsigned int negate  :1;
 };
 
+/* string a line must contain for a line-local script to touch it */
+typedef struct {
+	char  *lit;
+	size_t len;
+	size_t pos; /* offset in chunk of next occurrence, chunk.end for none */
+} Key;
+
 /* Files for w command (and s' w flag) */
 typedef struct {
 	char *path;
@@ -122,6 +155,7 @@ static void push(Vec *v, void *p);
 static void stracat(String *dst, char *src);
 static void strnacat(String *dst, char *src, size_t n);
 static void stracpy(String *dst, char *src);
+static void memacat(String *dst, size_t *len, char *src, size_t n);
 
 /* Cleanup and errors */
 static void usage(void);
@@ -129,6 +163,7 @@ static void usage(void);
 /* Parsing functions and related utilities */
 static void compile(char *s, int isfile);
 static int read_line(FILE *f, String *s);
+static int read_keyed_line(FILE *f, String *s);
 static char *make_range(Range *range, char *s);
 static char *make_addr(Addr *addr, char *s);
 static char *find_delim(char *s, Rune delim, int do_brackets);
@@ -139,6 +174,10 @@ static long stol(char *s, char **endp);
 static size_t escapes(char *beg, char *end, Rune delim, int n_newline);
 static size_t echarntorune(Rune *r, char *s, size_t n);
 static void insert_labels(void);
+static void strip_noops(void);
+static void find_keys(void);
+static Raddr *get_raddr(char *s);
+static char *relit(char *re);
 
 /* Get and Free arg and related utilities */
 static char *get_aci_arg(Cmd *c, char *s);
@@ -147,6 +186,7 @@ static void free_acir_arg(Cmd *c);
 static char *get_bt_arg(Cmd *c, char *s);
 static char *get_r_arg(Cmd *c, char *s);
 static char *get_s_arg(Cmd *c, char *s);
+static void make_repl(Cmd *c);
 static void free_s_arg(Cmd *c);
 static char *get_w_arg(Cmd *c, char *s);
 static char *get_y_arg(Cmd *c, char *s);
@@ -161,6 +201,9 @@ static void run(void);
 static int in_range(Cmd *c);
 static int match_addr(Addr *a);
 static int next_file(void);
+static int begin_inplace(char *path, FILE *f);
+static void end_inplace(void);
+static int file_end(Cmd *c);
 static int is_eof(FILE *f);
 static void do_writes(void);
 static void write_file(char *path, FILE *out);
@@ -208,20 +251,41 @@ static void old_next(void);
 static Vec braces, labels, branches; /* holds ptrdiff_t. addrs of {, :, bt */
 static Vec writes; /* holds cmd*. writes scheduled by a and r commands */
 static Vec wfiles; /* holds Wfile*. files for w and s///w commands */
+static Vec raddrs; /* holds Raddr*. regexes used in addresses */
+static Vec keys;   /* holds Key*. see find_keys() */
+
+/* input of a keyed script, complete lines are [off, end) */
+static struct {
+	char  *buf;
+	size_t cap;
+	size_t len;
+	size_t off;
+	size_t end;
+} chunk;
+static int keyed; /* read current file with read_keyed_line() */
 
 static Cmd   *prog, *pc; /* Program, program counter */
 static size_t pcap;
 static size_t lineno;
+static size_t pattgen = 1; /* changes whenever patt does */
 
 static regex_t *lastre; /* last used regex for empty regex search */
 static char   **files;  /* list of file names from argv */
 static FILE    *file;   /* current file we are reading */
 
+/* with -i the file being edited and the temporary file replacing it, which
+ * stdout writes to */
+static char    *ipath;
+static char     itmp[PATH_MAX];
+static int      ierr;   /* a file could not be edited in place */
+
 static String patt, hold, genbuf;
 
 static struct {
 	unsigned int n       :1; /* -n (no print) */
 	unsigned int E       :1; /* -E (extended re) */
+	unsigned int i       :1; /* -i (edit files in place) */
+	unsigned int sep     :1; /* -s (separate files) */
 	unsigned int s       :1; /* s/// replacement happened */
 	unsigned int aci_cont:1; /* a,c,i text continuation */
 	unsigned int s_cont  :1; /* s/// replacement text continuation */
@@ -342,6 +406,17 @@ stracpy(String *dst, char *src)
 	strcpy(dst->str, src);
 }
 
+/* append n bytes of src to dst which holds a string of length *len */
+static void
+memacat(String *dst, size_t *len, char *src, size_t n)
+{
+	if (dst->cap < *len + n + 1)
+		resize((void **)&dst->str, &dst->cap, 1, (*len + n + 1) * 2, NULL);
+	memcpy(dst->str + *len, src, n);
+	*len += n;
+	dst->str[*len] = '\0';
+}
+
 static void
 leprintf(char *s)
 {
@@ -446,6 +521,72 @@ read_line(FILE *f, String *s)
 	return 0;
 }
 
+/* like read_line() for a keyed script, but copy lines that contain none of
+ * the keys straight to stdout (unless -n) and return the next one that does
+ */
+static int
+read_keyed_line(FILE *f, String *s)
+{
+	Key *k;
+	char *p, *q, *end, *cand;
+	size_t i, n, len;
+
+	if (!f)
+		return EOF;
+
+	for (;;) {
+		if (chunk.off < chunk.end) {
+			p    = chunk.buf + chunk.off;
+			end  = chunk.buf + chunk.end;
+			cand = end;
+			for (i = 0; i < keys.size; i++) {
+				k = keys.data[i];
+				if (k->pos < chunk.off || k->pos > chunk.end) {
+					q = memmem(p, end - p, k->lit, k->len);
+					k->pos = q ? (size_t)(q - chunk.buf) : chunk.end;
+				}
+				cand = MIN(cand, chunk.buf + k->pos);
+			}
+			for (q = cand; q > p && q[-1] != '\n'; q--)
+				;
+			if (!gflags.n && q > p && fwrite(p, 1, q - p, stdout) != (size_t)(q - p))
+				eprintf("fwrite:");
+			if (cand == end) {
+				chunk.off = chunk.end;
+				continue;
+			}
+			cand = memchr(cand, '\n', end - cand);
+			len = 0;
+			memacat(s, &len, q, cand - q);
+			chunk.off = cand + 1 - chunk.buf;
+			return 0;
+		}
+
+		/* keep the incomplete last line and read more after it */
+		memmove(chunk.buf, chunk.buf + chunk.end, chunk.len - chunk.end);
+		chunk.len -= chunk.end;
+		chunk.off = chunk.end = 0;
+		for (i = 0; i < keys.size; i++)
+			((Key *)keys.data[i])->pos = (size_t)-1;
+
+		if (chunk.cap - chunk.len < 2)
+			resize((void **)&chunk.buf, &chunk.cap, 1, chunk.cap * 2 + BUFSIZ * 16, NULL);
+		if ((n = fread(chunk.buf + chunk.len, 1, chunk.cap - chunk.len - 1, f))) {
+			chunk.len += n;
+		} else {
+			if (ferror(f))
+				eprintf("fread:");
+			if (!chunk.len)
+				return EOF;
+			/* no newline at end of file, we add one anyway */
+			chunk.buf[chunk.len++] = '\n';
+		}
+		for (p = chunk.buf + chunk.len; p > chunk.buf && p[-1] != '\n'; p--)
+			;
+		chunk.end = p - chunk.buf;
+	}
+}
+
 /* read first range from s, return pointer to one past end of range */
 static char *
 make_range(Range *range, char *s)
@@ -500,8 +641,7 @@ make_addr(Addr *addr, char *s)
 				leprintf("unclosed regex");
 			p -= escapes(s, p, delim, 0);
 			*p++ = '\0';
-			addr->u.re = emalloc(sizeof(*addr->u.re));
-			eregcomp(addr->u.re, s, gflags.E ? REG_EXTENDED : 0);
+			addr->u.ra = get_raddr(s);
 			s = p;
 		}
 	} else {
@@ -511,6 +651,41 @@ make_addr(Addr *addr, char *s)
 	return s;
 }
 
+/* return the shared regex address for regex s, compile it if new */
+static Raddr *
+get_raddr(char *s)
+{
+	Raddr *ra;
+	size_t i;
+
+	for (i = 0; i < raddrs.size; i++) {
+		ra = raddrs.data[i];
+		if (ra->E == gflags.E && !strcmp(ra->str, s))
+			return ra;
+	}
+
+	ra = emalloc(sizeof(*ra));
+	eregcomp(&ra->re, s, gflags.E ? REG_EXTENDED : 0);
+	ra->str = estrdup(s);
+	ra->lit = relit(s);
+	ra->E = gflags.E;
+	ra->gen = 0;
+	push(&raddrs, ra);
+
+	return ra;
+}
+
+/* return copy of regex re if it has no special characters, so matching it is
+ * the same as searching for the string, else NULL
+ */
+static char *
+relit(char *re)
+{
+	if (strpbrk(re, gflags.E ? "\\.[*^$+?(){}|" : "\\.[*^$"))
+		return NULL;
+	return estrdup(re);
+}
+
 /* return pointer to first delim in s that is not escaped
  * and if do_brackets is set, not in [] (note possible [::], [..], [==], inside [])
  * return pointer to trailing nul byte if no delim found
@@ -685,6 +860,7 @@ insert_labels(void)
 			for (i = 0; i < labels.size; i++) {
 				to = prog + (ptrdiff_t)labels.data[i];
 				if (!strcmp(from->u.label, to->u.label)) {
+					free(from->u.label);
 					from->u.jump = to;
 					break;
 				}
@@ -695,6 +871,90 @@ insert_labels(void)
 	}
 }
 
+/* : and } do nothing when run, drop them from the program
+ * jumps to them go to the last command kept before them instead, which is
+ * then the last command skipped by the jump
+ */
+static void
+strip_noops(void)
+{
+	Cmd *c;
+	size_t i, n, *next;
+
+	next = ereallocarray(NULL, pcap + 1, sizeof(*next));
+	for (i = n = 0; i < pcap; i++) {
+		next[i] = n;
+		c = prog + i;
+		if (c->fninfo->fn == cmd_colon)
+			free(c->u.label);
+		else if (c->fninfo->fn != cmd_rbrace)
+			prog[n++] = *c;
+	}
+	next[pcap] = n;
+
+	/* jumps are kept as offsets until prog has been shrunk */
+	for (c = prog; c < prog + n; c++) {
+		if (c->fninfo->fn == cmd_b || c->fninfo->fn == cmd_t)
+			c->u.offset = (ptrdiff_t)next[c->u.jump - prog + 1] - 1;
+		else if (c->fninfo->fn == cmd_lbrace)
+			c->u.offset = next[c->u.offset + 1] - 1;
+	}
+	free(next);
+
+	resize((void **)&prog, &pcap, sizeof(*prog), n, NULL);
+	for (c = prog; c < prog + n; c++)
+		if (c->fninfo->fn == cmd_b || c->fninfo->fn == cmd_t)
+			c->u.jump = prog + c->u.offset;
+}
+
+/* a script of only s, d, p and y commands, each with at most one regex
+ * address, handles every line on its own. such a command can only change or
+ * print a line containing its address regex, or its s regex if it has no
+ * address. if all of those are plain strings collect them in keys, lines
+ * without any of them go to the output untouched
+ */
+static void
+find_keys(void)
+{
+	static Key nul = { "", 1, 0 }; /* lines with nul bytes get truncated */
+	Cmd *c;
+	Key *k;
+	char *lit;
+
+	for (c = prog; c < prog + pcap - 1; c++) {
+		if (c->fninfo->fn == cmd_s) {
+			if (!c->u.s.re || c->u.s.file)
+				break;
+		} else if (c->fninfo->fn != cmd_d && c->fninfo->fn != cmd_p &&
+		           c->fninfo->fn != cmd_y) {
+			break;
+		}
+		if (c->negate)
+			break;
+
+		if (c->range.naddr == 0 && c->fninfo->fn == cmd_s)
+			lit = c->u.s.lit;
+		else if (c->range.naddr == 1 && c->range.beg.type == REGEX)
+			lit = c->range.beg.u.ra->lit;
+		else
+			lit = NULL;
+		if (!lit)
+			break;
+
+		k = emalloc(sizeof(*k));
+		k->lit = lit;
+		k->len = strlen(lit);
+		push(&keys, k);
+	}
+
+	if (c < prog + pcap - 1) {
+		while (keys.size)
+			free(pop(&keys));
+		return;
+	}
+	push(&keys, &nul);
+}
+
 /*
  * Getargs / Freeargs
  * Read argument from s, return pointer to one past last character of argument
@@ -819,7 +1079,10 @@ get_s_arg(Cmd *c, char *s)
 	/* Find */
 	if (!gflags.s_cont) { /* NOT continuing from literal newline in replacement text */
 		lastre = 0;
+		c->u.s.lit = NULL;
 		c->u.s.repl = (String){ NULL, 0 };
+		c->u.s.parts = NULL;
+		c->u.s.nparts = 0;
 		c->u.s.occurrence = 1;
 		c->u.s.file = NULL;
 		c->u.s.p = 0;
@@ -847,6 +1110,9 @@ get_s_arg(Cmd *c, char *s)
 			c->u.s.re = emalloc(sizeof(*c->u.s.re));
 			/* FIXME: different eregcomp that calls fatal */
 			eregcomp(c->u.s.re, s, gflags.E ? REG_EXTENDED : 0);
+			/* no special characters, search for the string itself */
+			if ((c->u.s.lit = relit(s)))
+				c->u.s.litlen = strlen(s);
 		}
 		s = p + runelen(delim);
 	}
@@ -881,6 +1147,7 @@ get_s_arg(Cmd *c, char *s)
 
 	if (gflags.s_cont)
 		return p;
+	make_repl(c);
 
 	s = p + runelen(delim);
 
@@ -909,13 +1176,55 @@ get_s_arg(Cmd *c, char *s)
 	return p;
 }
 
+/* split replacement text into literal text, & and back-references so
+ * cmd_s() doesn't have to scan it for every match
+ */
+static void
+make_repl(Cmd *c)
+{
+	Rpart *rp;
+	String lit = { NULL, 0 };
+	size_t len = 0;
+	char *p;
+
+	for (p = c->u.s.repl.str; ; p++) {
+		if (*p && *p != '&' && *p != '\\') {
+			memacat(&lit, &len, p, 1);
+			continue;
+		}
+		if (*p == '\\' && p[1] && !isdigit(p[1])) {
+			/* character after backslash taken literally (well one byte, but it works) */
+			memacat(&lit, &len, ++p, 1);
+			continue;
+		}
+		if (len) {
+			resize((void **)&c->u.s.parts, &c->u.s.nparts, sizeof(*rp), c->u.s.nparts + 1, (void **)&rp);
+			rp->str = lit.str;
+			rp->len = len;
+			lit = (String){ NULL, 0 };
+			len = 0;
+		}
+		if (!*p || (*p == '\\' && !*++p))
+			break;
+		resize((void **)&c->u.s.parts, &c->u.s.nparts, sizeof(*rp), c->u.s.nparts + 1, (void **)&rp);
+		rp->str = NULL;
+		rp->len = (*p == '&') ? 0 : (size_t)(*p - '0');
+	}
+}
+
 static void
 free_s_arg(Cmd *c)
 {
+	size_t i;
+
 	if (c->u.s.re)
 		regfree(c->u.s.re);
 	free(c->u.s.re);
+	free(c->u.s.lit);
 	free(c->u.s.repl.str);
+	for (i = 0; i < c->u.s.nparts; i++)
+		free(c->u.s.parts[i].str);
+	free(c->u.s.parts);
 }
 
 /* see get_r_arg notes */
@@ -1047,6 +1356,8 @@ run(void)
 	stracpy(&hold, "");
 
 	insert_labels();
+	strip_noops();
+	find_keys();
 	next_file();
 	new_line();
 
@@ -1084,12 +1395,18 @@ match_addr(Addr *a)
 	case EVERY: return 1;
 	case LINE: return lineno == a->u.lineno;
 	case LAST:
+		if (gflags.sep)
+			return is_eof(file);
 		while (is_eof(file) && !next_file())
 			;
 		return !file;
 	case REGEX:
-		lastre = a->u.re;
-		return !regexec(a->u.re, patt.str, 0, NULL, 0);
+		lastre = &a->u.ra->re;
+		if (a->u.ra->gen != pattgen) {
+			a->u.ra->match = !regexec(lastre, patt.str, 0, NULL, 0);
+			a->u.ra->gen = pattgen;
+		}
+		return a->u.ra->match;
 	case LASTRE:
 		if (!lastre)
 			leprintf("no previous regex");
@@ -1105,31 +1422,126 @@ static int
 next_file(void)
 {
 	static unsigned char first = 1;
+	struct stat st;
 
 	if (file == stdin)
 		clearerr(file);
 	else if (file)
 		fshut(file, "<file>");
 	file = NULL;
+	if (ipath)
+		end_inplace();
 
 	do {
 		if (!*files) {
 			if (first) /* given no files, default to stdin */
 				file = stdin;
 			/* else we've used all our files, leave file = NULL */
+		} else if (gflags.i && !strcmp(*files, "-")) {
+			weprintf("-: can't edit stdin in place\n");
+			ierr = 1;
+			files++;
 		} else if (!strcmp(*files, "-")) {
 			file = stdin;
 			files++;
 		} else if (!(file = fopen(*files++, "r"))) {
 			/* warn this file didn't open, but move on to next */
-			weprintf("fopen:");
+			weprintf("fopen %s:", files[-1]);
+			if (gflags.i)
+				ierr = 1;
+		} else if (gflags.i && begin_inplace(files[-1], file)) {
+			fshut(file, files[-1]);
+			file = NULL;
+			ierr = 1;
 		}
 	} while (!file && *files);
 	first = 0;
+	if (gflags.sep)
+		lineno = 0;
+
+	/* only regular files, reading ahead would hold up pipes and terminals */
+	keyed = file && keys.size && !fstat(fileno(file), &st) && S_ISREG(st.st_mode);
 
 	return !file;
 }
 
+/* make stdout a temporary file in the same directory as path with the same
+ * owner and mode, return -1 if path can't be edited in place
+ */
+static int
+begin_inplace(char *path, FILE *f)
+{
+	struct stat st;
+	mode_t mode;
+	char *p;
+	int fd, n;
+
+	if (fstat(fileno(f), &st) < 0) {
+		weprintf("fstat %s:", path);
+		return -1;
+	}
+	if (!S_ISREG(st.st_mode)) {
+		weprintf("%s: not a regular file\n", path);
+		return -1;
+	}
+
+	n = (p = strrchr(path, '/')) ? p - path + 1 : 0;
+	if (snprintf(itmp, sizeof(itmp), "%.*ssedXXXXXX", n, path) >= (int)sizeof(itmp)) {
+		weprintf("%s: path too long\n", path);
+		return -1;
+	}
+	if ((fd = mkstemp(itmp)) < 0) {
+		weprintf("mkstemp %s:", itmp);
+		return -1;
+	}
+
+	/* without the owner setuid and setgid bits would be given away */
+	mode = st.st_mode & 07777;
+	if (fchown(fd, st.st_uid, st.st_gid) < 0)
+		mode &= ~(S_ISUID | S_ISGID);
+	if (fchmod(fd, mode) < 0)
+		weprintf("fchmod %s:", itmp);
+
+	if (fflush(stdout) == EOF)
+		eprintf("fflush:");
+	if (dup2(fd, STDOUT_FILENO) < 0)
+		eprintf("dup2:");
+	close(fd);
+	ipath = path;
+
+	return 0;
+}
+
+/* replace the file edited in place with the temporary file */
+static void
+end_inplace(void)
+{
+	int err;
+
+	if (fflush(stdout) == EOF || fsync(STDOUT_FILENO) < 0 ||
+	    rename(itmp, ipath) < 0) {
+		err = errno;
+		unlink(itmp);
+		errno = err;
+		eprintf("%s:", ipath);
+	}
+	ipath = NULL;
+}
+
+/* with -s n and N don't read the next file at the end of one, instead branch
+ * to the end of the script. return 1 if that happened
+ */
+static int
+file_end(Cmd *c)
+{
+	if (!gflags.sep || !is_eof(file))
+		return 0;
+
+	update_ranges(c + 1, prog + pcap - 1);
+	pc = prog + pcap - 2;
+	return 1;
+}
+
 /* test if stream is at EOF */
 static int
 is_eof(FILE *f)
@@ -1196,8 +1608,15 @@ check_puts(char *s, FILE *f)
 static void
 update_ranges(Cmd *beg, Cmd *end)
 {
-	while (beg < end)
-		in_range(beg++);
+	/* only ranges keep state, other addresses can at most set lastre */
+	for (; beg < end; beg++) {
+		if (beg->range.naddr == 2)
+			in_range(beg);
+		else if (beg->range.beg.type == REGEX)
+			lastre = &beg->range.beg.u.ra->re;
+		else if (beg->range.beg.type == LASTRE && !lastre)
+			leprintf("no previous regex");
+	}
 }
 
 /*
@@ -1217,7 +1636,7 @@ cmd_b(Cmd *c)
 		return;
 
 	/* if we jump backwards update to end, otherwise update to destination */
-	update_ranges(c + 1, c->u.jump > c ? c->u.jump : prog + pcap);
+	update_ranges(c + 1, c->u.jump >= c ? c->u.jump + 1 : prog + pcap);
 	pc = c->u.jump;
 }
 
@@ -1255,6 +1674,7 @@ cmd_D(Cmd *c)
 	if ((p = strchr(patt.str, '\n'))) {
 		p++;
 		memmove(patt.str, p, strlen(p) + 1);
+		pattgen++;
 		old_next();
 	} else {
 		new_next();
@@ -1264,8 +1684,11 @@ cmd_D(Cmd *c)
 static void
 cmd_g(Cmd *c)
 {
-	if (in_range(c))
-		stracpy(&patt, hold.str);
+	if (!in_range(c))
+		return;
+
+	stracpy(&patt, hold.str);
+	pattgen++;
 }
 
 static void
@@ -1276,6 +1699,7 @@ cmd_G(Cmd *c)
 
 	stracat(&patt, "\n");
 	stracat(&patt, hold.str);
+	pattgen++;
 }
 
 static void
@@ -1350,7 +1774,7 @@ cmd_l(Cmd *c)
 static void
 cmd_n(Cmd *c)
 {
-	if (!in_range(c))
+	if (!in_range(c) || file_end(c))
 		return;
 
 	if (!gflags.n)
@@ -1362,7 +1786,7 @@ cmd_n(Cmd *c)
 static void
 cmd_N(Cmd *c)
 {
-	if (!in_range(c))
+	if (!in_range(c) || file_end(c))
 		return;
 	do_writes();
 	app_line();
@@ -1414,13 +1838,16 @@ cmd_r(Cmd *c)
 static void
 cmd_s(Cmd *c)
 {
+	static regmatch_t *pmatch = NULL;
+	static size_t pcap = 0;
 	String tmp;
 	Rune r;
-	size_t plen, rlen, len;
+	size_t i, plen, rlen, glen = 0;
 	char *p, *s, *end;
 	unsigned int matches = 0, last_empty = 1, qflag = 0, cflags = 0;
 	regex_t *re;
-	regmatch_t *rm, *pmatch = NULL;
+	regmatch_t *rm;
+	Rpart *rp;
 
 	if (!in_range(c))
 		return;
@@ -1432,10 +1859,33 @@ cmd_s(Cmd *c)
 	lastre = re;
 
 	plen = re->re_nsub + 1;
-	pmatch = ereallocarray(NULL, plen, sizeof(regmatch_t));
+	if (pcap < plen)
+		resize((void **)&pmatch, &pcap, sizeof(*pmatch), plen, NULL);
 
-	*genbuf.str = '\0';
 	s = patt.str;
+	end = s + strlen(s);
+
+	if (c->u.s.re && c->u.s.lit) {
+		/* no special characters in regex, matches are never empty */
+		while ((p = strstr(s, c->u.s.lit))) {
+			pmatch[0].rm_so = p - s;
+			pmatch[0].rm_eo = pmatch[0].rm_so + c->u.s.litlen;
+			if (++matches == c->u.s.occurrence || !c->u.s.occurrence) {
+				memacat(&genbuf, &glen, s, pmatch[0].rm_so);
+				for (rp = c->u.s.parts; rp < c->u.s.parts + c->u.s.nparts; rp++)
+					if (rp->str)
+						memacat(&genbuf, &glen, rp->str, rp->len);
+					else
+						memacat(&genbuf, &glen, p, c->u.s.litlen);
+			} else {
+				memacat(&genbuf, &glen, s, pmatch[0].rm_eo);
+			}
+			s += pmatch[0].rm_eo;
+			if (matches == c->u.s.occurrence)
+				break;
+		}
+		goto done;
+	}
 
 	while (!qflag && !regexec(re, s, plen, pmatch, cflags)) {
 		cflags = REG_NOTBOL; /* match against beginning of line first time, but not again */
@@ -1449,67 +1899,53 @@ cmd_s(Cmd *c)
 		if ((last_empty || pmatch[0].rm_eo) &&
 		    (++matches == c->u.s.occurrence || !c->u.s.occurrence)) {
 			/* copy over everything before the match */
-			strnacat(&genbuf, s, pmatch[0].rm_so);
+			memacat(&genbuf, &glen, s, pmatch[0].rm_so);
 
 			/* copy over replacement text, taking into account &, backreferences, and \ escapes */
-			for (p = c->u.s.repl.str, len = strcspn(p, "\\&"); *p; len = strcspn(++p, "\\&")) {
-				strnacat(&genbuf, p, len);
-				p += len;
-				switch (*p) {
-				default: leprintf("this shouldn't be possible");
-				case '\0':
-					/* we're at the end, back up one so the ++p will put us on
-					 * the null byte to break out of the loop */
-					--p;
-					break;
-				case '&':
-					strnacat(&genbuf, s + pmatch[0].rm_so, pmatch[0].rm_eo - pmatch[0].rm_so);
-					break;
-				case '\\':
-					if (isdigit(*++p)) { /* backreference */
-						/* only need to check here if using lastre, otherwise we checked when building */
-						if (!c->u.s.re && (size_t)(*p - '0') > re->re_nsub)
-							leprintf("back reference number greater than number of groups");
-						rm = &pmatch[*p - '0'];
-						strnacat(&genbuf, s + rm->rm_so, rm->rm_eo - rm->rm_so);
-					} else { /* character after backslash taken literally (well one byte, but it works) */
-						strnacat(&genbuf, p, 1);
-					}
-					break;
+			for (i = 0; i < c->u.s.nparts; i++) {
+				rp = &c->u.s.parts[i];
+				if (rp->str) {
+					memacat(&genbuf, &glen, rp->str, rp->len);
+					continue;
 				}
+				/* only need to check here if using lastre, otherwise we checked when building */
+				if (!c->u.s.re && rp->len > re->re_nsub)
+					leprintf("back reference number greater than number of groups");
+				rm = &pmatch[rp->len];
+				memacat(&genbuf, &glen, s + rm->rm_so, rm->rm_eo - rm->rm_so);
 			}
 		} else {
 			/* not replacing, copy over everything up to and including the match */
-			strnacat(&genbuf, s, pmatch[0].rm_eo);
+			memacat(&genbuf, &glen, s, pmatch[0].rm_eo);
 		}
 
 		if (!pmatch[0].rm_eo) { /* empty match, advance one rune and add it to output */
-			end = s + strlen(s);
 			rlen = charntorune(&r, s, end - s);
 
 			if (!rlen) { /* ran out of bytes, copy short sequence */
-				stracat(&genbuf, s);
+				memacat(&genbuf, &glen, s, end - s);
 				s = end;
 			} else { /* copy whether or not it's a good rune */
-				strnacat(&genbuf, s, rlen);
+				memacat(&genbuf, &glen, s, rlen);
 				s += rlen;
 			}
 		}
 		last_empty = !pmatch[0].rm_eo;
 		s += pmatch[0].rm_eo;
 	}
-	free(pmatch);
 
+done:
 	if (!(matches && matches >= c->u.s.occurrence)) /* no replacement */
 		return;
 
 	gflags.s = 1;
 
-	stracat(&genbuf, s);
+	memacat(&genbuf, &glen, s, end - s);
 
 	tmp    = patt;
 	patt   = genbuf;
 	genbuf = tmp;
+	pattgen++;
 
 	if (c->u.s.p)
 		check_puts(patt.str, stdout);
@@ -1524,7 +1960,7 @@ cmd_t(Cmd *c)
 		return;
 
 	/* if we jump backwards update to end, otherwise update to destination */
-	update_ranges(c + 1, c->u.jump > c ? c->u.jump : prog + pcap);
+	update_ranges(c + 1, c->u.jump >= c ? c->u.jump + 1 : prog + pcap);
 	pc = c->u.jump;
 	gflags.s = 0;
 }
@@ -1547,6 +1983,7 @@ cmd_x(Cmd *c)
 	tmp  = patt;
 	patt = hold;
 	hold = tmp;
+	pattgen++;
 }
 
 static void
@@ -1582,6 +2019,7 @@ cmd_y(Cmd *c)
 	tmp    = patt;
 	patt   = genbuf;
 	genbuf = tmp;
+	pattgen++;
 }
 
 static void
@@ -1606,7 +2044,7 @@ cmd_lbrace(Cmd *c)
 
 	/* update ranges on all commands we skip */
 	jump = prog + c->u.offset;
-	update_ranges(c + 1, jump);
+	update_ranges(c + 1, jump + 1);
 	pc = jump;
 }
 
@@ -1633,7 +2071,7 @@ cmd_last(Cmd *c)
 static void
 new_line(void)
 {
-	while (read_line(file, &patt) == EOF) {
+	while ((keyed ? read_keyed_line(file, &patt) : read_line(file, &patt)) == EOF) {
 		if (next_file()) {
 			gflags.halt = 1;
 			return;
@@ -1641,6 +2079,7 @@ new_line(void)
 	}
 	gflags.s = 0;
 	lineno++;
+	pattgen++;
 }
 
 /* append new line, continue current cycle
@@ -1662,6 +2101,7 @@ app_line(void)
 	stracat(&patt, genbuf.str);
 	gflags.s = 0;
 	lineno++;
+	pattgen++;
 }
 
 /* read new line, start new cycle */
@@ -1669,6 +2109,7 @@ static void
 new_next(void)
 {
 	*patt.str = '\0';
+	pattgen++;
 	update_ranges(pc + 1, prog + pcap);
 	new_line();
 	pc = prog - 1;
@@ -1696,6 +2137,12 @@ main(int argc, char *argv[])
 	case 'E':
 		gflags.E = 1;
 		break;
+	case 'i':
+		gflags.i = 1;
+		/* fallthrough */
+	case 's':
+		gflags.sep = 1;
+		break;
 	case 'e':
 		arg = EARGF(usage());
 		compile(arg, 0);
@@ -1721,10 +2168,23 @@ main(int argc, char *argv[])
 	resize((void **)&prog, &pcap, sizeof(*prog), pc - prog + 1, NULL);
 	pc = prog + pcap - 1;
 	pc->fninfo = &(Fninfo){ cmd_last, NULL, NULL, 0 };
+	pc->range.beg.type = EVERY;
+	pc->range.end.type = IGNORE;
+	pc->range.naddr = 0;
+	pc->in_match = pc->negate = 0;
 
 	files = argv;
+	if (gflags.i) {
+		if (!*files)
+			usage();
+		setvbuf(stdout, NULL, _IOFBF, BUFSIZ * 16);
+	}
 	run();
+	/* q leaves the current file open */
+	if (ipath)
+		end_inplace();
 
+	ret |= ierr;
 	ret |= fshut(stdin, "<stdin>") | fshut(stdout, "<stdout>");
 
 	return ret;
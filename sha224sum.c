@@ -1,6 +1,7 @@
 /* See LICENSE file for copyright and license details. */
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "crypt.h"
 #include "sha224.h"
@@ -17,7 +18,7 @@ struct crypt_ops sha224_ops = {
 static void
 usage(void)
 {
-	eprintf("usage: %s [-c] [file ...]\n", argv0);
+	eprintf("usage: %s [-c] [-f] [-j jobs] [file ...]\n", argv0);
 }
 
 int
@@ -30,6 +31,12 @@ main(int argc, char *argv[])
 	case 'c':
 		cryptfunc = cryptcheck;
 		break;
+	case 'f':
+		crypt_failfast = 1;
+		break;
+	case 'j':
+		crypt_jobs = estrtonum(EARGF(usage()), 1, 256);
+		break;
 	default:
 		usage();
 	} ARGEND
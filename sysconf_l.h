@@ -0,0 +1,354 @@
+#ifdef _SC_AIO_LISTIO_MAX
+	{"AIO_LISTIO_MAX",	_SC_AIO_LISTIO_MAX},
+#endif
+#ifdef _SC_AIO_MAX
+	{"AIO_MAX",	_SC_AIO_MAX},
+#endif
+#ifdef _SC_AIO_PRIO_DELTA_MAX
+	{"AIO_PRIO_DELTA_MAX",	_SC_AIO_PRIO_DELTA_MAX},
+#endif
+#ifdef _SC_ARG_MAX
+	{"ARG_MAX",	_SC_ARG_MAX},
+#endif
+#ifdef _SC_ATEXIT_MAX
+	{"ATEXIT_MAX",	_SC_ATEXIT_MAX},
+#endif
+#ifdef _SC_BC_BASE_MAX
+	{"BC_BASE_MAX",	_SC_BC_BASE_MAX},
+#endif
+#ifdef _SC_BC_DIM_MAX
+	{"BC_DIM_MAX",	_SC_BC_DIM_MAX},
+#endif
+#ifdef _SC_BC_SCALE_MAX
+	{"BC_SCALE_MAX",	_SC_BC_SCALE_MAX},
+#endif
+#ifdef _SC_BC_STRING_MAX
+	{"BC_STRING_MAX",	_SC_BC_STRING_MAX},
+#endif
+#ifdef _SC_CHILD_MAX
+	{"CHILD_MAX",	_SC_CHILD_MAX},
+#endif
+#ifdef _SC_COLL_WEIGHTS_MAX
+	{"COLL_WEIGHTS_MAX",	_SC_COLL_WEIGHTS_MAX},
+#endif
+#ifdef _SC_DELAYTIMER_MAX
+	{"DELAYTIMER_MAX",	_SC_DELAYTIMER_MAX},
+#endif
+#ifdef _SC_EXPR_NEST_MAX
+	{"EXPR_NEST_MAX",	_SC_EXPR_NEST_MAX},
+#endif
+#ifdef _SC_HOST_NAME_MAX
+	{"HOST_NAME_MAX",	_SC_HOST_NAME_MAX},
+#endif
+#ifdef _SC_IOV_MAX
+	{"IOV_MAX",	_SC_IOV_MAX},
+#endif
+#ifdef _SC_LINE_MAX
+	{"LINE_MAX",	_SC_LINE_MAX},
+#endif
+#ifdef _SC_LOGIN_NAME_MAX
+	{"LOGIN_NAME_MAX",	_SC_LOGIN_NAME_MAX},
+#endif
+#ifdef _SC_NGROUPS_MAX
+	{"NGROUPS_MAX",	_SC_NGROUPS_MAX},
+#endif
+#ifdef _SC_MQ_OPEN_MAX
+	{"MQ_OPEN_MAX",	_SC_MQ_OPEN_MAX},
+#endif
+#ifdef _SC_MQ_PRIO_MAX
+	{"MQ_PRIO_MAX",	_SC_MQ_PRIO_MAX},
+#endif
+#ifdef _SC_OPEN_MAX
+	{"OPEN_MAX",	_SC_OPEN_MAX},
+#endif
+#ifdef _SC_ADVISORY_INFO
+	{"_POSIX_ADVISORY_INFO",	_SC_ADVISORY_INFO},
+#endif
+#ifdef _SC_BARRIERS
+	{"_POSIX_BARRIERS",	_SC_BARRIERS},
+#endif
+#ifdef _SC_ASYNCHRONOUS_IO
+	{"_POSIX_ASYNCHRONOUS_IO",	_SC_ASYNCHRONOUS_IO},
+#endif
+#ifdef _SC_CLOCK_SELECTION
+	{"_POSIX_CLOCK_SELECTION",	_SC_CLOCK_SELECTION},
+#endif
+#ifdef _SC_CPUTIME
+	{"_POSIX_CPUTIME",	_SC_CPUTIME},
+#endif
+#ifdef _SC_FSYNC
+	{"_POSIX_FSYNC",	_SC_FSYNC},
+#endif
+#ifdef _SC_IPV6
+	{"_POSIX_IPV6",	_SC_IPV6},
+#endif
+#ifdef _SC_JOB_CONTROL
+	{"_POSIX_JOB_CONTROL",	_SC_JOB_CONTROL},
+#endif
+#ifdef _SC_MAPPED_FILES
+	{"_POSIX_MAPPED_FILES",	_SC_MAPPED_FILES},
+#endif
+#ifdef _SC_MEMLOCK
+	{"_POSIX_MEMLOCK",	_SC_MEMLOCK},
+#endif
+#ifdef _SC_MEMLOCK_RANGE
+	{"_POSIX_MEMLOCK_RANGE",	_SC_MEMLOCK_RANGE},
+#endif
+#ifdef _SC_MEMORY_PROTECTION
+	{"_POSIX_MEMORY_PROTECTION",	_SC_MEMORY_PROTECTION},
+#endif
+#ifdef _SC_MESSAGE_PASSING
+	{"_POSIX_MESSAGE_PASSING",	_SC_MESSAGE_PASSING},
+#endif
+#ifdef _SC_MONOTONIC_CLOCK
+	{"_POSIX_MONOTONIC_CLOCK",	_SC_MONOTONIC_CLOCK},
+#endif
+#ifdef _SC_PRIORITIZED_IO
+	{"_POSIX_PRIORITIZED_IO",	_SC_PRIORITIZED_IO},
+#endif
+#ifdef _SC_PRIORITY_SCHEDULING
+	{"_POSIX_PRIORITY_SCHEDULING",	_SC_PRIORITY_SCHEDULING},
+#endif
+#ifdef _SC_RAW_SOCKETS
+	{"_POSIX_RAW_SOCKETS",	_SC_RAW_SOCKETS},
+#endif
+#ifdef _SC_READER_WRITER_LOCKS
+	{"_POSIX_READER_WRITER_LOCKS",	_SC_READER_WRITER_LOCKS},
+#endif
+#ifdef _SC_REALTIME_SIGNALS
+	{"_POSIX_REALTIME_SIGNALS",	_SC_REALTIME_SIGNALS},
+#endif
+#ifdef _SC_REGEXP
+	{"_POSIX_REGEXP",	_SC_REGEXP},
+#endif
+#ifdef _SC_SAVED_IDS
+	{"_POSIX_SAVED_IDS",	_SC_SAVED_IDS},
+#endif
+#ifdef _SC_SEMAPHORES
+	{"_POSIX_SEMAPHORES",	_SC_SEMAPHORES},
+#endif
+#ifdef _SC_SHARED_MEMORY_OBJECTS
+	{"_POSIX_SHARED_MEMORY_OBJECTS",	_SC_SHARED_MEMORY_OBJECTS},
+#endif
+#ifdef _SC_SHELL
+	{"_POSIX_SHELL",	_SC_SHELL},
+#endif
+#ifdef _SC_SPAWN
+	{"_POSIX_SPAWN",	_SC_SPAWN},
+#endif
+#ifdef _SC_SPIN_LOCKS
+	{"_POSIX_SPIN_LOCKS",	_SC_SPIN_LOCKS},
+#endif
+#ifdef _SC_SPORADIC_SERVER
+	{"_POSIX_SPORADIC_SERVER",	_SC_SPORADIC_SERVER},
+#endif
+#ifdef _SC_SS_REPL_MAX
+	{"_POSIX_SS_REPL_MAX",	_SC_SS_REPL_MAX},
+#endif
+#ifdef _SC_SYNCHRONIZED_IO
+	{"_POSIX_SYNCHRONIZED_IO",	_SC_SYNCHRONIZED_IO},
+#endif
+#ifdef _SC_THREAD_ATTR_STACKADDR
+	{"_POSIX_THREAD_ATTR_STACKADDR",	_SC_THREAD_ATTR_STACKADDR},
+#endif
+#ifdef _SC_THREAD_ATTR_STACKSIZE
+	{"_POSIX_THREAD_ATTR_STACKSIZE",	_SC_THREAD_ATTR_STACKSIZE},
+#endif
+#ifdef _SC_THREAD_CPUTIME
+	{"_POSIX_THREAD_CPUTIME",	_SC_THREAD_CPUTIME},
+#endif
+#ifdef _SC_THREAD_PRIO_INHERIT
+	{"_POSIX_THREAD_PRIO_INHERIT",	_SC_THREAD_PRIO_INHERIT},
+#endif
+#ifdef _SC_THREAD_PRIO_PROTECT
+	{"_POSIX_THREAD_PRIO_PROTECT",	_SC_THREAD_PRIO_PROTECT},
+#endif
+#ifdef _SC_THREAD_PRIORITY_SCHEDULING
+	{"_POSIX_THREAD_PRIORITY_SCHEDULING",	_SC_THREAD_PRIORITY_SCHEDULING},
+#endif
+#ifdef _SC_THREAD_PROCESS_SHARED
+	{"_POSIX_THREAD_PROCESS_SHARED",	_SC_THREAD_PROCESS_SHARED},
+#endif
+#ifdef _SC_THREAD_ROBUST_PRIO_INHERIT
+	{"_POSIX_THREAD_ROBUST_PRIO_INHERIT",	_SC_THREAD_ROBUST_PRIO_INHERIT},
+#endif
+#ifdef _SC_THREAD_ROBUST_PRIO_PROTECT
+	{"_POSIX_THREAD_ROBUST_PRIO_PROTECT",	_SC_THREAD_ROBUST_PRIO_PROTECT},
+#endif
+#ifdef _SC_THREAD_SAFE_FUNCTIONS
+	{"_POSIX_THREAD_SAFE_FUNCTIONS",	_SC_THREAD_SAFE_FUNCTIONS},
+#endif
+#ifdef _SC_THREAD_SPORADIC_SERVER
+	{"_POSIX_THREAD_SPORADIC_SERVER",	_SC_THREAD_SPORADIC_SERVER},
+#endif
+#ifdef _SC_THREADS
+	{"_POSIX_THREADS",	_SC_THREADS},
+#endif
+#ifdef _SC_TIMEOUTS
+	{"_POSIX_TIMEOUTS",	_SC_TIMEOUTS},
+#endif
+#ifdef _SC_TIMERS
+	{"_POSIX_TIMERS",	_SC_TIMERS},
+#endif
+#ifdef _SC_TRACE
+	{"_POSIX_TRACE",	_SC_TRACE},
+#endif
+#ifdef _SC_TRACE_EVENT_FILTER
+	{"_POSIX_TRACE_EVENT_FILTER",	_SC_TRACE_EVENT_FILTER},
+#endif
+#ifdef _SC_TRACE_EVENT_NAME_MAX
+	{"_POSIX_TRACE_EVENT_NAME_MAX",	_SC_TRACE_EVENT_NAME_MAX},
+#endif
+#ifdef _SC_TRACE_INHERIT
+	{"_POSIX_TRACE_INHERIT",	_SC_TRACE_INHERIT},
+#endif
+#ifdef _SC_TRACE_LOG
+	{"_POSIX_TRACE_LOG",	_SC_TRACE_LOG},
+#endif
+#ifdef _SC_TRACE_NAME_MAX
+	{"_POSIX_TRACE_NAME_MAX",	_SC_TRACE_NAME_MAX},
+#endif
+#ifdef _SC_TRACE_SYS_MAX
+	{"_POSIX_TRACE_SYS_MAX",	_SC_TRACE_SYS_MAX},
+#endif
+#ifdef _SC_TRACE_USER_EVENT_MAX
+	{"_POSIX_TRACE_USER_EVENT_MAX",	_SC_TRACE_USER_EVENT_MAX},
+#endif
+#ifdef _SC_TYPED_MEMORY_OBJECTS
+	{"_POSIX_TYPED_MEMORY_OBJECTS",	_SC_TYPED_MEMORY_OBJECTS},
+#endif
+#ifdef _SC_VERSION
+	{"_POSIX_VERSION",	_SC_VERSION},
+#endif
+#ifdef _SC_V7_ILP32_OFF32
+	{"_POSIX_V7_ILP32_OFF32",	_SC_V7_ILP32_OFF32},
+#endif
+#ifdef _SC_V7_ILP32_OFFBIG
+	{"_POSIX_V7_ILP32_OFFBIG",	_SC_V7_ILP32_OFFBIG},
+#endif
+#ifdef _SC_V7_LP64_OFF64
+	{"_POSIX_V7_LP64_OFF64",	_SC_V7_LP64_OFF64},
+#endif
+#ifdef _SC_V7_LPBIG_OFFBIG
+	{"_POSIX_V7_LPBIG_OFFBIG",	_SC_V7_LPBIG_OFFBIG},
+#endif
+#ifdef _SC_2_C_BIND
+	{"_POSIX2_C_BIND",	_SC_2_C_BIND},
+#endif
+#ifdef _SC_2_C_DEV
+	{"_POSIX2_C_DEV",	_SC_2_C_DEV},
+#endif
+#ifdef _SC_2_CHAR_TERM
+	{"_POSIX2_CHAR_TERM",	_SC_2_CHAR_TERM},
+#endif
+#ifdef _SC_2_FORT_DEV
+	{"_POSIX2_FORT_DEV",	_SC_2_FORT_DEV},
+#endif
+#ifdef _SC_2_FORT_RUN
+	{"_POSIX2_FORT_RUN",	_SC_2_FORT_RUN},
+#endif
+#ifdef _SC_2_LOCALEDEF
+	{"_POSIX2_LOCALEDEF",	_SC_2_LOCALEDEF},
+#endif
+#ifdef _SC_2_PBS
+	{"_POSIX2_PBS",	_SC_2_PBS},
+#endif
+#ifdef _SC_2_PBS_ACCOUNTING
+	{"_POSIX2_PBS_ACCOUNTING",	_SC_2_PBS_ACCOUNTING},
+#endif
+#ifdef _SC_2_PBS_CHECKPOINT
+	{"_POSIX2_PBS_CHECKPOINT",	_SC_2_PBS_CHECKPOINT},
+#endif
+#ifdef _SC_2_PBS_LOCATE
+	{"_POSIX2_PBS_LOCATE",	_SC_2_PBS_LOCATE},
+#endif
+#ifdef _SC_2_PBS_MESSAGE
+	{"_POSIX2_PBS_MESSAGE",	_SC_2_PBS_MESSAGE},
+#endif
+#ifdef _SC_2_PBS_TRACK
+	{"_POSIX2_PBS_TRACK",	_SC_2_PBS_TRACK},
+#endif
+#ifdef _SC_2_SW_DEV
+	{"_POSIX2_SW_DEV",	_SC_2_SW_DEV},
+#endif
+#ifdef _SC_2_UPE
+	{"_POSIX2_UPE",	_SC_2_UPE},
+#endif
+#ifdef _SC_2_VERSION
+	{"_POSIX2_VERSION",	_SC_2_VERSION},
+#endif
+#ifdef _SC_PAGE_SIZE
+	{"PAGE_SIZE",	_SC_PAGE_SIZE},
+#endif
+#ifdef _SC_PAGESIZE
+	{"PAGESIZE",	_SC_PAGESIZE},
+#endif
+#ifdef _SC_THREAD_DESTRUCTOR_ITERATIONS
+	{"PTHREAD_DESTRUCTOR_ITERATIONS",	_SC_THREAD_DESTRUCTOR_ITERATIONS},
+#endif
+#ifdef _SC_THREAD_KEYS_MAX
+	{"PTHREAD_KEYS_MAX",	_SC_THREAD_KEYS_MAX},
+#endif
+#ifdef _SC_THREAD_STACK_MIN
+	{"PTHREAD_STACK_MIN",	_SC_THREAD_STACK_MIN},
+#endif
+#ifdef _SC_THREAD_THREADS_MAX
+	{"PTHREAD_THREADS_MAX",	_SC_THREAD_THREADS_MAX},
+#endif
+#ifdef _SC_RE_DUP_MAX
+	{"RE_DUP_MAX",	_SC_RE_DUP_MAX},
+#endif
+#ifdef _SC_RTSIG_MAX
+	{"RTSIG_MAX",	_SC_RTSIG_MAX},
+#endif
+#ifdef _SC_SEM_NSEMS_MAX
+	{"SEM_NSEMS_MAX",	_SC_SEM_NSEMS_MAX},
+#endif
+#ifdef _SC_SEM_VALUE_MAX
+	{"SEM_VALUE_MAX",	_SC_SEM_VALUE_MAX},
+#endif
+#ifdef _SC_SIGQUEUE_MAX
+	{"SIGQUEUE_MAX",	_SC_SIGQUEUE_MAX},
+#endif
+#ifdef _SC_STREAM_MAX
+	{"STREAM_MAX",	_SC_STREAM_MAX},
+#endif
+#ifdef _SC_SYMLOOP_MAX
+	{"SYMLOOP_MAX",	_SC_SYMLOOP_MAX},
+#endif
+#ifdef _SC_TIMER_MAX
+	{"TIMER_MAX",	_SC_TIMER_MAX},
+#endif
+#ifdef _SC_TTY_NAME_MAX
+	{"TTY_NAME_MAX",	_SC_TTY_NAME_MAX},
+#endif
+#ifdef _SC_TZNAME_MAX
+	{"TZNAME_MAX",	_SC_TZNAME_MAX},
+#endif
+#ifdef _SC_XOPEN_CRYPT
+	{"_XOPEN_CRYPT",	_SC_XOPEN_CRYPT},
+#endif
+#ifdef _SC_XOPEN_ENH_I18N
+	{"_XOPEN_ENH_I18N",	_SC_XOPEN_ENH_I18N},
+#endif
+#ifdef _SC_XOPEN_REALTIME
+	{"_XOPEN_REALTIME",	_SC_XOPEN_REALTIME},
+#endif
+#ifdef _SC_XOPEN_REALTIME_THREADS
+	{"_XOPEN_REALTIME_THREADS",	_SC_XOPEN_REALTIME_THREADS},
+#endif
+#ifdef _SC_XOPEN_SHM
+	{"_XOPEN_SHM",	_SC_XOPEN_SHM},
+#endif
+#ifdef _SC_XOPEN_STREAMS
+	{"_XOPEN_STREAMS",	_SC_XOPEN_STREAMS},
+#endif
+#ifdef _SC_XOPEN_UNIX
+	{"_XOPEN_UNIX",	_SC_XOPEN_UNIX},
+#endif
+#ifdef _SC_XOPEN_UUCP
+	{"_XOPEN_UUCP",	_SC_XOPEN_UUCP},
+#endif
+#ifdef _SC_XOPEN_VERSION
+	{"_XOPEN_VERSION",	_SC_XOPEN_VERSION},
+#endif
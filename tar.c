@@ -1,22 +1,37 @@
 /* See LICENSE file for copyright and license details. */
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/wait.h>
 
 #include <errno.h>
 #include <fcntl.h>
 #include <grp.h>
 #include <libgen.h>
+#include <limits.h>
 #include <pwd.h>
+#include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#include "deflate.h"
 #include "fs.h"
 #include "util.h"
 
 #define BLKSIZ 512
 
+/* glibc hides these without _GNU_SOURCE */
+#if !defined(SEEK_DATA) && defined(__linux__)
+#define SEEK_DATA 3
+#define SEEK_HOLE 4
+#endif
+
+/* files opened and read ahead of the one being archived */
+#define PREFETCH    64
+#define PREFETCHSIZ (32 << 20)
+
 enum Type {
 	REG       = '0',
 	AREG      = '\0',
@@ -26,7 +41,10 @@ enum Type {
 	BLOCKDEV  = '4',
 	DIRECTORY = '5',
 	FIFO      = '6',
-	RESERVED  = '7'
+	RESERVED  = '7',
+	SPARSE    = 'S',
+	EXTENDED  = 'x',
+	GLOBAL    = 'g'
 };
 
 struct header {
@@ -48,31 +66,121 @@ struct header {
 	char prefix[155];
 };
 
+/* the old GNU format keeps a sparse map where ustar has its prefix,
+ * entries that do not fit follow in extension blocks */
+struct sparse {
+	char atime[12];
+	char ctime[12];
+	char offset[12];
+	char longnames[4];
+	char unused;
+	char sp[4][2][12];
+	char isextended;
+	char realsize[12];
+};
+
+struct sparseext {
+	char sp[21][2][12];
+	char isextended;
+};
+
+/* the data of a sparse file */
+static struct extent {
+	off_t off;
+	off_t len;
+} *extents;
+
+static size_t nextents;
+static off_t realsize;
+
+/* pax extended header records of the next member */
+static char *pax;
+static size_t paxlen, paxsiz;
+static char paxhdr[BLKSIZ];
+
+/* and what they say, size and mtime.tv_nsec are -1 if not given */
+static struct {
+	char *path;
+	char *linkpath;
+	off_t size;
+	struct timespec mtime;
+} ext = { .size = -1, .mtime.tv_nsec = -1 };
+
+/* files with more than one link, by device and inode */
+static struct link {
+	dev_t dev;
+	ino_t ino;
+	char *name;
+	struct link *next;
+} *links[4096];
+
 static struct dirtime {
 	char *name;
-	time_t mtime;
+	struct timespec mtime;
 } *dirtimes;
 
 static size_t dirtimeslen;
 
+static struct pending {
+	char *path;
+	struct stat st;
+	int fd;
+	const char *link;
+} pending[PREFETCH];
+
+static size_t npending, pendhead;
+static off_t pendsize;
+
 static int tarfd;
 static ino_t tarinode;
 static dev_t tardev;
 
+/* the archive is read and written in records of blocks */
+static char *tarbuf;
+static size_t tarbufsiz = 20 * BLKSIZ, tarbuflen, tarbufoff;
+static off_t tarpos, tarstart;
+static int tarseek;
+
+/* with -I, header offsets of the members to look at */
+static const char *idxfile;
+static FILE *idxfp;
+static off_t *idxoff;
+static size_t idxlen;
+
+/* with -n, regular files are written by jobs fed through pipes,
+ * links wait for them to finish */
+static int njobs = 1, *jobfd;
+static pid_t *jobpid;
+static struct deferred {
+	char *name;
+	char *linkpath;
+	struct timespec mtime;
+	char b[BLKSIZ];
+} *deferred;
+static size_t ndeferred;
+
 static int mflag, vflag;
 static int filtermode;
 static const char *filtertool;
+static struct deflate gz;
+static struct inflate gunz;
+
+/* with -c, -z and -n, the archive is cut in blocks of ZBLKSIZ that jobs
+ * compress into gzip members of their own, which are written in order */
+enum { ZBLKSIZ = 1 << 17 };
+static int *zjobres;
+static char *zbuf;
+static size_t zbuflen, zsent, zdone;
 
 static const char *filtertools[] = {
 	['J'] = "xz",
 	['Z'] = "compress",
 	['a'] = "lzma",
 	['j'] = "bzip2",
-	['z'] = "gzip",
 };
 
 static void
-pushdirtime(char *name, time_t mtime)
+pushdirtime(char *name, struct timespec mtime)
 {
 	dirtimes = reallocarray(dirtimes, dirtimeslen + 1, sizeof(*dirtimes));
 	dirtimes[dirtimeslen].name = strdup(name);
@@ -165,99 +273,634 @@ ewrite(int fd, const void *buf, size_t n)
 	return r;
 }
 
+static size_t
+readfull(int fd, void *buf, size_t n)
+{
+	size_t l;
+	ssize_t r;
+
+	for (l = 0; l < n && (r = eread(fd, (char *)buf + l, n - l)) > 0; l += r)
+		;
+	return l;
+}
+
+static void
+zjob(int in, int out)
+{
+	struct deflate d;
+	char *b;
+	size_t n;
+
+	b = emalloc(ZBLKSIZ);
+	while (readfull(in, &n, sizeof(n)) == sizeof(n)) {
+		if (n > ZBLKSIZ || readfull(in, b, n) != n)
+			eprintf("compression job: short block\n");
+		deflate_init(&d);
+		deflate_update(&d, b, n);
+		deflate_finish(&d);
+		ewrite(out, &d.outlen, sizeof(d.outlen));
+		ewrite(out, d.out, d.outlen);
+		free(d.out);
+	}
+	_exit(0);
+}
+
+static void
+startzjobs(void)
+{
+	int in[2], out[2], i, j;
+
+	jobfd = ecalloc(njobs, sizeof(*jobfd));
+	jobpid = ecalloc(njobs, sizeof(*jobpid));
+	zjobres = ecalloc(njobs, sizeof(*zjobres));
+	zbuf = emalloc(ZBLKSIZ);
+	if (idxfp)
+		fflush(idxfp);
+	for (i = 0; i < njobs; i++) {
+		if (pipe(in) < 0 || pipe(out) < 0)
+			eprintf("pipe:");
+		switch ((jobpid[i] = fork())) {
+		case -1:
+			eprintf("fork:");
+		case 0:
+			for (j = 0; j < i; j++) {
+				close(jobfd[j]);
+				close(zjobres[j]);
+			}
+			close(in[1]);
+			close(out[0]);
+			close(tarfd);
+			zjob(in[0], out[1]);
+		}
+		close(in[0]);
+		close(out[1]);
+		jobfd[i] = in[1];
+		zjobres[i] = out[0];
+	}
+	signal(SIGPIPE, SIG_IGN);
+}
+
+/* write out the oldest block the jobs are working on */
+static void
+zcollect(void)
+{
+	static char *b;
+	static size_t bsiz;
+	int fd = zjobres[zdone % njobs];
+	size_t n;
+
+	if (readfull(fd, &n, sizeof(n)) != sizeof(n))
+		eprintf("compression job failed\n");
+	if (n > bsiz)
+		b = erealloc(b, bsiz = n);
+	if (readfull(fd, b, n) != n)
+		eprintf("compression job failed\n");
+	ewrite(tarfd, b, n);
+	zdone++;
+}
+
+/* a job gets a new block once its last one is written out */
+static void
+zsend(void)
+{
+	int fd = jobfd[zsent % njobs];
+
+	if (zsent - zdone == (size_t)njobs)
+		zcollect();
+	ewrite(fd, &zbuflen, sizeof(zbuflen));
+	ewrite(fd, zbuf, zbuflen);
+	zsent++;
+	zbuflen = 0;
+}
+
+static void
+zput(const char *p, size_t l)
+{
+	size_t n;
+
+	for (; l > 0; l -= n, p += n) {
+		n = MIN(ZBLKSIZ - zbuflen, l);
+		memcpy(zbuf + zbuflen, p, n);
+		if ((zbuflen += n) == ZBLKSIZ)
+			zsend();
+	}
+}
+
+static void
+zfinish(void)
+{
+	int i, status;
+
+	if (zbuflen)
+		zsend();
+	for (i = 0; i < njobs; i++)
+		close(jobfd[i]);
+	while (zdone < zsent)
+		zcollect();
+	for (i = 0; i < njobs; i++) {
+		close(zjobres[i]);
+		if (waitpid(jobpid[i], &status, 0) < 0)
+			eprintf("waitpid:");
+		if (!WIFEXITED(status) || WEXITSTATUS(status))
+			eprintf("compression job failed\n");
+	}
+}
+
 static void
-putoctal(char *dst, unsigned num, int size)
+putoctal(char *dst, unsigned long long num, int size)
 {
-	if (snprintf(dst, size, "%.*o", size - 1, num) >= size)
+	if (snprintf(dst, size, "%.*llo", size - 1, num) >= size)
 		eprintf("snprintf: input number too large\n");
 }
 
+/* octal if it fits, else base-256 as GNU tar does */
+static void
+putnum(char *dst, unsigned long long num, int size)
+{
+	int i;
+
+	if (num < 1ULL << 3 * (size - 1)) {
+		putoctal(dst, num, size);
+		return;
+	}
+	for (i = size - 1; i > 0; i--, num >>= 8)
+		dst[i] = num & 0xff;
+	dst[0] = (char)0x80;
+}
+
+static void
+flushrec(void)
+{
+	if (zbuf) {
+		zput(tarbuf, tarbuflen);
+	} else if (filtermode == 'z') {
+		deflate_update(&gz, tarbuf, tarbuflen);
+		ewrite(tarfd, gz.out, gz.outlen);
+		gz.outlen = 0;
+	} else if (tarbuflen) {
+		ewrite(tarfd, tarbuf, tarbuflen);
+	}
+	tarpos += tarbuflen;
+	tarbuflen = 0;
+}
+
+static void
+putblk(const char *b)
+{
+	if (tarbuflen == tarbufsiz)
+		flushrec();
+	memcpy(tarbuf + tarbuflen, b, BLKSIZ);
+	tarbuflen += BLKSIZ;
+}
+
+static void
+putdata(int fd, const char *path, off_t l)
+{
+	ssize_t r;
+	size_t n;
+
+	/* read straight into the record */
+	for (; l > 0; l -= r, tarbuflen += r) {
+		if (tarbuflen == tarbufsiz)
+			flushrec();
+		n = MIN((off_t)(tarbufsiz - tarbuflen), l);
+		if (!(r = eread(fd, tarbuf + tarbuflen, n))) {
+			weprintf("%s: file shrank\n", path);
+			memset(tarbuf + tarbuflen, 0, r = n);
+		}
+	}
+}
+
+static void
+putmem(const char *p, size_t l)
+{
+	size_t n;
+
+	for (; l > 0; l -= n, p += n) {
+		if (tarbuflen == tarbufsiz)
+			flushrec();
+		n = MIN(tarbufsiz - tarbuflen, l);
+		memcpy(tarbuf + tarbuflen, p, n);
+		tarbuflen += n;
+	}
+}
+
+static void
+padblk(void)
+{
+	size_t n;
+
+	n = -tarbuflen % BLKSIZ;
+	memset(tarbuf + tarbuflen, 0, n);
+	tarbuflen += n;
+}
+
+static void
+endarchive(void)
+{
+	char b[BLKSIZ] = { 0 };
+
+	/* two zero blocks, then the record is padded with zeros */
+	putblk(b);
+	putblk(b);
+	memset(tarbuf + tarbuflen, 0, tarbufsiz - tarbuflen);
+	tarbuflen = tarbufsiz;
+	flushrec();
+	if (zbuf) {
+		zfinish();
+	} else if (filtermode == 'z') {
+		deflate_finish(&gz);
+		ewrite(tarfd, gz.out, gz.outlen);
+	}
+}
+
+static ssize_t
+readtar(void *buf, size_t n)
+{
+	if (filtermode == 'z')
+		return inflate_read(&gunz, buf, n);
+	return eread(tarfd, buf, n);
+}
+
+static char *
+getblks(size_t *n)
+{
+	char *p;
+	ssize_t r;
+
+	/* up to n blocks, as many as there are left in the record */
+	if (tarbufoff == tarbuflen) {
+		tarbufoff = tarbuflen = 0;
+		while (tarbuflen < tarbufsiz &&
+		       (r = readtar(tarbuf + tarbuflen, tarbufsiz - tarbuflen)) > 0)
+			tarbuflen += r;
+		tarbuflen -= tarbuflen % BLKSIZ;
+		if (!tarbuflen)
+			return NULL;
+	}
+	*n = MIN(*n, (tarbuflen - tarbufoff) / BLKSIZ);
+	p = tarbuf + tarbufoff;
+	tarbufoff += *n * BLKSIZ;
+	return p;
+}
+
+static void
+seektar(off_t off)
+{
+	if (lseek(tarfd, tarstart + off, SEEK_SET) < 0)
+		eprintf("lseek:");
+	tarbufoff = tarbuflen = 0;
+}
+
+static const char *
+firstlink(const char *path, struct stat *st)
+{
+	struct link *l, **lp;
+
+	lp = &links[(st->st_ino ^ st->st_dev) % LEN(links)];
+	for (l = *lp; l; l = l->next)
+		if (l->ino == st->st_ino && l->dev == st->st_dev)
+			return l->name;
+	l = emalloc(sizeof(*l));
+	l->dev = st->st_dev;
+	l->ino = st->st_ino;
+	l->name = estrdup(path);
+	l->next = *lp;
+	*lp = l;
+	return NULL;
+}
+
+/* the extents of data in a file with holes, 0 if it has none */
 static int
-archive(const char *path)
+mapsparse(int fd, struct stat *st)
+{
+#ifdef SEEK_DATA
+	off_t off, end;
+
+	nextents = 0;
+	if (st->st_blocks * 512 >= st->st_size)
+		return 0;
+	for (off = 0; off < st->st_size; off = end) {
+		if ((off = lseek(fd, off, SEEK_DATA)) < 0) {
+			if (errno != ENXIO)
+				goto full;
+			break;
+		}
+		if ((end = lseek(fd, off, SEEK_HOLE)) < 0)
+			goto full;
+		if (off >= st->st_size)
+			break;
+		end = MIN(end, st->st_size);
+		extents = ereallocarray(extents, nextents + 1, sizeof(*extents));
+		extents[nextents].off = off;
+		extents[nextents++].len = end - off;
+	}
+	/* a hole at the end still needs an entry for the size */
+	if (!nextents || extents[nextents - 1].off + extents[nextents - 1].len < st->st_size) {
+		extents = ereallocarray(extents, nextents + 1, sizeof(*extents));
+		extents[nextents].off = st->st_size;
+		extents[nextents++].len = 0;
+	}
+	if (nextents == 1 && !extents[0].off)
+		goto full;
+	return 1;
+full:
+	nextents = 0;
+	if (lseek(fd, 0, SEEK_SET) < 0)
+		eprintf("lseek:");
+#endif
+	return 0;
+}
+
+static void
+chksum(struct header *h)
+{
+	size_t sum, i;
+
+	memset(h->chksum, ' ', sizeof(h->chksum));
+	for (i = 0, sum = 0; i < sizeof(*h); i++)
+		sum += ((unsigned char *)h)[i];
+	putoctal(h->chksum, sum, sizeof(h->chksum));
+}
+
+static void
+paxadd(const char *key, const char *val)
+{
+	size_t len, n, p;
+
+	/* the length of a record counts its own digits */
+	len = strlen(key) + strlen(val) + 3;
+	for (n = 1, p = 10; len + n >= p; n++, p *= 10)
+		;
+	len += n;
+	if (paxlen + len + 1 > paxsiz) {
+		paxsiz = paxlen + len + 1 + BLKSIZ;
+		pax = erealloc(pax, paxsiz);
+	}
+	paxlen += snprintf(pax + paxlen, len + 1, "%zu %s=%s\n", len, key, val);
+}
+
+/* the extended header for path, from what was added */
+static void
+putpax(const char *path, struct stat *st)
 {
 	char b[BLKSIZ];
+	struct header *h = (struct header *)b;
+	const char *base;
+
+	base = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+	memset(b, 0, sizeof(b));
+	snprintf(h->name, sizeof(h->name), "PaxHeaders/%s", base);
+	putoctal(h->mode,  0644,                     sizeof(h->mode));
+	putoctal(h->uid,   0,                        sizeof(h->uid));
+	putoctal(h->gid,   0,                        sizeof(h->gid));
+	putoctal(h->size,  paxlen,                   sizeof(h->size));
+	putoctal(h->mtime, (unsigned)st->st_mtime,   sizeof(h->mtime));
+	memcpy(h->magic,   "ustar",                  sizeof(h->magic));
+	memcpy(h->version, "00",                     sizeof(h->version));
+	h->type = EXTENDED;
+	chksum(h);
+	putblk(b);
+	putmem(pax, paxlen);
+	padblk();
+	paxlen = 0;
+}
+
+static int
+archive(const char *path, struct stat *st, int fd, const char *target)
+{
+	char b[BLKSIZ], e[BLKSIZ], lname[PATH_MAX], num[32];
 	struct group *gr;
 	struct header *h;
+	struct sparse *s;
+	struct sparseext *x;
 	struct passwd *pw;
-	struct stat st;
-	size_t chksum, i;
-	ssize_t l, r;
-	int fd = -1;
-
-	if (lstat(path, &st) < 0) {
-		weprintf("lstat %s:", path);
-		return 0;
-	} else if (st.st_ino == tarinode && st.st_dev == tardev) {
-		weprintf("ignoring %s\n", path);
-		return 0;
-	}
+	off_t size = 0, off;
+	size_t i, j;
+	ssize_t r;
 
-	pw = getpwuid(st.st_uid);
-	gr = getgrgid(st.st_gid);
+	pw = getpwuid(st->st_uid);
+	gr = getgrgid(st->st_gid);
 
 	h = (struct header *)b;
 	memset(b, 0, sizeof(b));
-	estrlcpy(h->name,    path,                        sizeof(h->name));
-	putoctal(h->mode,    (unsigned)st.st_mode & 0777, sizeof(h->mode));
-	putoctal(h->uid,     (unsigned)st.st_uid,         sizeof(h->uid));
-	putoctal(h->gid,     (unsigned)st.st_gid,         sizeof(h->gid));
-	putoctal(h->size,    0,                           sizeof(h->size));
-	putoctal(h->mtime,   (unsigned)st.st_mtime,       sizeof(h->mtime));
-	memcpy(  h->magic,   "ustar",                     sizeof(h->magic));
-	memcpy(  h->version, "00",                        sizeof(h->version));
-	estrlcpy(h->uname,   pw ? pw->pw_name : "",       sizeof(h->uname));
-	estrlcpy(h->gname,   gr ? gr->gr_name : "",       sizeof(h->gname));
-
-	if (S_ISREG(st.st_mode)) {
+	strncpy(h->name,     path,                         sizeof(h->name));
+	putoctal(h->mode,    (unsigned)st->st_mode & 0777, sizeof(h->mode));
+	putoctal(h->uid,     (unsigned)st->st_uid,         sizeof(h->uid));
+	putoctal(h->gid,     (unsigned)st->st_gid,         sizeof(h->gid));
+	putoctal(h->size,    0,                            sizeof(h->size));
+	putoctal(h->mtime,   (unsigned)st->st_mtime,       sizeof(h->mtime));
+	memcpy(  h->magic,   "ustar",                      sizeof(h->magic));
+	memcpy(  h->version, "00",                         sizeof(h->version));
+	estrlcpy(h->uname,   pw ? pw->pw_name : "",        sizeof(h->uname));
+	estrlcpy(h->gname,   gr ? gr->gr_name : "",        sizeof(h->gname));
+
+	if (strlen(path) > sizeof(h->name))
+		paxadd("path", path);
+
+	if (target) {
+		h->type = HARDLINK;
+		strncpy(h->linkname, target, sizeof(h->linkname));
+		if (strlen(target) > sizeof(h->linkname))
+			paxadd("linkpath", target);
+	} else if (S_ISREG(st->st_mode) && mapsparse(fd, st)) {
+		h->type = SPARSE;
+		memcpy(h->magic, "ustar ", sizeof(h->magic));
+		memcpy(h->version, " ", sizeof(h->version));
+		s = (struct sparse *)h->prefix;
+		for (i = 0; i < nextents; i++)
+			size += extents[i].len;
+		for (i = 0; i < nextents && i < LEN(s->sp); i++) {
+			putnum(s->sp[i][0], extents[i].off, sizeof(s->sp[i][0]));
+			putnum(s->sp[i][1], extents[i].len, sizeof(s->sp[i][1]));
+		}
+		s->isextended = i < nextents;
+		putnum(s->realsize, st->st_size, sizeof(s->realsize));
+		putnum(h->size, size, sizeof(h->size));
+	} else if (S_ISREG(st->st_mode)) {
 		h->type = REG;
-		putoctal(h->size, (unsigned)st.st_size,  sizeof(h->size));
-		fd = open(path, O_RDONLY);
-		if (fd < 0)
-			eprintf("open %s:", path);
-	} else if (S_ISDIR(st.st_mode)) {
+		size = st->st_size;
+		putnum(h->size, size,                       sizeof(h->size));
+		if (size >= 1LL << 33) {
+			snprintf(num, sizeof(num), "%lld", (long long)size);
+			paxadd("size", num);
+		}
+	} else if (S_ISDIR(st->st_mode)) {
 		h->type = DIRECTORY;
-	} else if (S_ISLNK(st.st_mode)) {
+	} else if (S_ISLNK(st->st_mode)) {
 		h->type = SYMLINK;
-		if ((r = readlink(path, h->linkname, sizeof(h->linkname) - 1)) < 0)
+		if ((r = readlink(path, lname, sizeof(lname) - 1)) < 0)
 			eprintf("readlink %s:", path);
-		h->linkname[r] = '\0';
-	} else if (S_ISCHR(st.st_mode) || S_ISBLK(st.st_mode)) {
-		h->type = S_ISCHR(st.st_mode) ? CHARDEV : BLOCKDEV;
-		putoctal(h->major, (unsigned)major(st.st_dev), sizeof(h->major));
-		putoctal(h->minor, (unsigned)minor(st.st_dev), sizeof(h->minor));
-	} else if (S_ISFIFO(st.st_mode)) {
+		j = MIN((size_t)r, sizeof(lname) - 1);
+		lname[j] = '\0';
+		memcpy(h->linkname, lname, MIN(j, sizeof(h->linkname)));
+		if (j > sizeof(h->linkname))
+			paxadd("linkpath", lname);
+	} else if (S_ISCHR(st->st_mode) || S_ISBLK(st->st_mode)) {
+		h->type = S_ISCHR(st->st_mode) ? CHARDEV : BLOCKDEV;
+		putoctal(h->major, (unsigned)major(st->st_dev), sizeof(h->major));
+		putoctal(h->minor, (unsigned)minor(st->st_dev), sizeof(h->minor));
+	} else if (S_ISFIFO(st->st_mode)) {
 		h->type = FIFO;
 	}
 
-	memset(h->chksum, ' ', sizeof(h->chksum));
-	for (i = 0, chksum = 0; i < sizeof(*h); i++)
-		chksum += (unsigned char)b[i];
-	putoctal(h->chksum, chksum, sizeof(h->chksum));
-	ewrite(tarfd, b, BLKSIZ);
-
-	if (fd != -1) {
-		while ((l = eread(fd, b, BLKSIZ)) > 0) {
-			if (l < BLKSIZ)
-				memset(b + l, 0, BLKSIZ - l);
-			ewrite(tarfd, b, BLKSIZ);
+	/* sparse members get no mtime record, the old GNU format is
+	 * left as it is */
+	if (st->st_mtim.tv_nsec && h->type != SPARSE) {
+		snprintf(num, sizeof(num), "%lld.%09ld",
+		         (long long)st->st_mtime, st->st_mtim.tv_nsec);
+		paxadd("mtime", num);
+	}
+
+	chksum(h);
+	off = tarpos + tarbuflen;
+	if (paxlen)
+		putpax(path, st);
+	if (idxfp && !strchr(path, '\n'))
+		fprintf(idxfp, "%lld %lld %c %s\n", (long long)off,
+		        (long long)size, h->type, path);
+	putblk(b);
+
+	if (h->type == SPARSE) {
+		for (i = LEN(s->sp); i < nextents; i += LEN(x->sp)) {
+			memset(e, 0, sizeof(e));
+			x = (struct sparseext *)e;
+			for (j = 0; j < LEN(x->sp) && i + j < nextents; j++) {
+				putnum(x->sp[j][0], extents[i + j].off, sizeof(x->sp[j][0]));
+				putnum(x->sp[j][1], extents[i + j].len, sizeof(x->sp[j][1]));
+			}
+			x->isextended = i + j < nextents;
+			putblk(e);
 		}
-		close(fd);
+		for (i = 0; i < nextents; i++) {
+			if (lseek(fd, extents[i].off, SEEK_SET) < 0)
+				eprintf("lseek %s:", path);
+			putdata(fd, path, extents[i].len);
+		}
+	} else if (h->type == REG) {
+		putdata(fd, path, size);
 	}
+	padblk();
+	if (fd != -1)
+		close(fd);
 
 	return 0;
 }
 
+static void
+skipblk(ssize_t l)
+{
+	size_t n;
+
+	for (; l > 0; l -= n * BLKSIZ) {
+		n = (l + BLKSIZ - 1) / BLKSIZ;
+		/* past what is buffered, seek if we can */
+		if (tarseek && tarbufoff == tarbuflen) {
+			if (lseek(tarfd, n * BLKSIZ, SEEK_CUR) < 0)
+				eprintf("lseek:");
+			break;
+		}
+		if (!getblks(&n))
+			break;
+	}
+}
+
+static off_t
+getoctal(const char *f, size_t n)
+{
+	char tmp[13], *p;
+	long long v;
+	size_t i;
+
+	if (*f & 0x80) {
+		for (v = 0, i = 1; i < n; i++)
+			v = v << 8 | (unsigned char)f[i];
+		return v;
+	}
+	snprintf(tmp, sizeof(tmp), "%.*s", (int)MIN(n, sizeof(tmp) - 1), f);
+	if ((v = strtoll(tmp, &p, 8)) < 0 || (*p != '\0' && *p != ' '))
+		eprintf("strtoll %s: invalid number\n", tmp);
+	return v;
+}
+
+/* the sparse map of h and its extension blocks */
+static void
+getsparse(struct header *h)
+{
+	struct sparse *s = (struct sparse *)h->prefix;
+	struct sparseext *x;
+	char (*sp)[2][12], e[BLKSIZ], *p;
+	size_t i, n, one;
+	int more;
+
+	realsize = getoctal(s->realsize, sizeof(s->realsize));
+	sp = s->sp;
+	n = LEN(s->sp);
+	more = s->isextended;
+	for (nextents = 0;;) {
+		for (i = 0; i < n && sp[i][0][0]; i++) {
+			extents = ereallocarray(extents, nextents + 1, sizeof(*extents));
+			extents[nextents].off = getoctal(sp[i][0], sizeof(sp[i][0]));
+			extents[nextents++].len = getoctal(sp[i][1], sizeof(sp[i][1]));
+		}
+		if (!more)
+			break;
+		if (!(one = 1, p = getblks(&one)))
+			eprintf("unexpected end of archive\n");
+		memcpy(e, p, BLKSIZ);
+		x = (struct sparseext *)e;
+		sp = x->sp;
+		n = LEN(x->sp);
+		more = x->isextended;
+	}
+}
+
+/* data as stored, into the extents of a sparse file */
+static void
+putsparse(int fd, const char *fname, ssize_t l)
+{
+	size_t i, n, k, avail = 0;
+	off_t len;
+	char *p = NULL;
+
+	for (i = 0; i < nextents; i++) {
+		if (lseek(fd, extents[i].off, SEEK_SET) < 0)
+			eprintf("lseek %s:", fname);
+		for (len = extents[i].len; len > 0; len -= k) {
+			if (!avail) {
+				n = (l + BLKSIZ - 1) / BLKSIZ;
+				if (l <= 0 || !(p = getblks(&n)))
+					eprintf("%s: sparse map does not match data\n", fname);
+				avail = MIN(l, n * BLKSIZ);
+				l -= n * BLKSIZ;
+			}
+			k = MIN(len, avail);
+			ewrite(fd, p, k);
+			p += k;
+			avail -= k;
+		}
+	}
+	skipblk(l);
+	if (ftruncate(fd, realsize) < 0)
+		eprintf("ftruncate %s:", fname);
+}
+
 static int
 unarchive(char *fname, ssize_t l, char b[BLKSIZ])
 {
-	char lname[101], *tmp, *p;
+	char lbuf[101], *lname = lbuf, *tmp, *p;
 	long mode, major, minor, type, mtime, uid, gid;
+	size_t n;
 	struct header *h = (struct header *)b;
 	int fd = -1;
 	struct timespec times[2];
 
 	if (!mflag && ((mtime = strtol(h->mtime, &p, 8)) < 0 || *p != '\0'))
 		eprintf("strtol %s: invalid number\n", h->mtime);
+	times[0].tv_sec = times[1].tv_sec = mtime;
+	times[0].tv_nsec = times[1].tv_nsec = 0;
+	if (ext.mtime.tv_nsec >= 0)
+		times[0] = times[1] = ext.mtime;
 	if (remove(fname) < 0 && errno != ENOENT)
 		weprintf("remove %s:", fname);
 
@@ -269,6 +912,7 @@ unarchive(char *fname, ssize_t l, char b[BLKSIZ])
 	case REG:
 	case AREG:
 	case RESERVED:
+	case SPARSE:
 		if ((mode = strtol(h->mode, &p, 8)) < 0 || *p != '\0')
 			eprintf("strtol %s: invalid number\n", h->mode);
 		fd = open(fname, O_WRONLY | O_TRUNC | O_CREAT, 0600);
@@ -277,8 +921,10 @@ unarchive(char *fname, ssize_t l, char b[BLKSIZ])
 		break;
 	case HARDLINK:
 	case SYMLINK:
-		snprintf(lname, sizeof(lname), "%.*s", (int)sizeof(h->linkname),
+		snprintf(lbuf, sizeof(lbuf), "%.*s", (int)sizeof(h->linkname),
 		         h->linkname);
+		if (ext.linkpath)
+			lname = ext.linkpath;
 		if (((h->type == HARDLINK) ? link : symlink)(lname, fname) < 0)
 			eprintf("%s %s -> %s:",
 			        (h->type == HARDLINK) ? "link" : "symlink",
@@ -289,7 +935,7 @@ unarchive(char *fname, ssize_t l, char b[BLKSIZ])
 			eprintf("strtol %s: invalid number\n", h->mode);
 		if (mkdir(fname, (mode_t)mode) < 0 && errno != EEXIST)
 			eprintf("mkdir %s:", fname);
-		pushdirtime(fname, mtime);
+		pushdirtime(fname, times[1]);
 		break;
 	case CHARDEV:
 	case BLOCKDEV:
@@ -318,18 +964,22 @@ unarchive(char *fname, ssize_t l, char b[BLKSIZ])
 	if ((gid = strtol(h->gid, &p, 8)) < 0 || *p != '\0')
 		eprintf("strtol %s: invalid number\n", h->gid);
 
-	if (fd != -1) {
-		for (; l > 0; l -= BLKSIZ)
-			if (eread(tarfd, b, BLKSIZ) > 0)
-				ewrite(fd, b, MIN(l, BLKSIZ));
+	if (fd != -1 && h->type == SPARSE) {
+		putsparse(fd, fname, l);
+		close(fd);
+	} else if (fd != -1) {
+		for (; l > 0; l -= n * BLKSIZ) {
+			n = (l + BLKSIZ - 1) / BLKSIZ;
+			if (!(p = getblks(&n)))
+				break;
+			ewrite(fd, p, MIN(l, n * BLKSIZ));
+		}
 		close(fd);
 	}
 
 	if (h->type == HARDLINK)
 		return 0;
 
-	times[0].tv_sec = times[1].tv_sec = mtime;
-	times[0].tv_nsec = times[1].tv_nsec = 0;
 	if (!mflag && utimensat(AT_FDCWD, fname, times, AT_SYMLINK_NOFOLLOW) < 0)
 		weprintf("utimensat %s:\n", fname);
 	if (h->type == SYMLINK) {
@@ -345,16 +995,6 @@ unarchive(char *fname, ssize_t l, char b[BLKSIZ])
 	return 0;
 }
 
-static void
-skipblk(ssize_t l)
-{
-	char b[BLKSIZ];
-
-	for (; l > 0; l -= BLKSIZ)
-		if (!eread(tarfd, b, BLKSIZ))
-			break;
-}
-
 static int
 print(char *fname, ssize_t l, char b[BLKSIZ])
 {
@@ -363,10 +1003,55 @@ print(char *fname, ssize_t l, char b[BLKSIZ])
 	return 0;
 }
 
+static void
+archivenext(void)
+{
+	struct pending *p = &pending[pendhead];
+
+	archive(p->path, &p->st, p->fd, p->link);
+	if (p->fd != -1)
+		pendsize -= p->st.st_size;
+	free(p->path);
+	pendhead = (pendhead + 1) % PREFETCH;
+	npending--;
+}
+
+static void
+prefetch(const char *path)
+{
+	struct pending *p;
+
+	while (npending == PREFETCH || (npending && pendsize >= PREFETCHSIZ))
+		archivenext();
+
+	p = &pending[(pendhead + npending) % PREFETCH];
+	if (lstat(path, &p->st) < 0) {
+		weprintf("lstat %s:", path);
+		return;
+	} else if (p->st.st_ino == tarinode && p->st.st_dev == tardev) {
+		weprintf("ignoring %s\n", path);
+		return;
+	}
+	p->fd = -1;
+	p->link = NULL;
+	if (S_ISREG(p->st.st_mode) && p->st.st_nlink > 1)
+		p->link = firstlink(path, &p->st);
+	if (S_ISREG(p->st.st_mode) && !p->link) {
+		if ((p->fd = open(path, O_RDONLY)) < 0)
+			eprintf("open %s:", path);
+		/* have the system start reading it while earlier
+		 * files are archived */
+		posix_fadvise(p->fd, 0, MIN(p->st.st_size, PREFETCHSIZ), POSIX_FADV_WILLNEED);
+		pendsize += p->st.st_size;
+	}
+	p->path = estrdup(path);
+	npending++;
+}
+
 static void
 c(const char *path, struct stat *st, void *data, struct recursor *r)
 {
-	archive(path);
+	prefetch(path);
 	if (vflag)
 		puts(path);
 
@@ -394,9 +1079,10 @@ sanitize(struct header *h)
 
 	/* Numeric fields can be terminated with spaces instead of
 	 * NULs as per the ustar specification.  Patch all of them to
-	 * use NULs so we can perform string operations on them. */
+	 * use NULs so we can perform string operations on them.
+	 * Base-256 numbers are binary and left alone. */
 	for (i = 0; i < LEN(fields); i++)
-		for (j = 0; j < fields[i].l; j++)
+		for (j = 0; j < fields[i].l && !(fields[i].f[0] & 0x80); j++)
 			if (fields[i].f[j] == ' ')
 				fields[i].f[j] = '\0';
 }
@@ -430,59 +1116,305 @@ bad:
 	eprintf("malformed tar archive\n");
 }
 
+static void
+readidx(int argc, char *argv[])
+{
+	FILE *fp = idxfp;
+	char *line = NULL, *p;
+	size_t size = 0, found = 0;
+	ssize_t len;
+	long long off;
+	int i, *seen;
+
+	seen = ecalloc(argc, sizeof(*seen));
+	while ((len = getline(&line, &size, fp)) > 0) {
+		if (line[len - 1] == '\n')
+			line[--len] = '\0';
+		/* offset size type name */
+		if ((off = strtoll(line, &p, 10)) < 0 || *p != ' ' ||
+		    strtoll(p + 1, &p, 10) < 0 || *p != ' ' || !p[1] || p[2] != ' ')
+			eprintf("%s: malformed index\n", idxfile);
+		for (i = 0; i < argc; i++)
+			if (!strcmp(argv[i], p + 3))
+				break;
+		if (i == argc)
+			continue;
+		found += !seen[i];
+		seen[i] = 1;
+		idxoff = ereallocarray(idxoff, idxlen + 1, sizeof(*idxoff));
+		idxoff[idxlen++] = off;
+	}
+	if (ferror(fp))
+		eprintf("getline %s:", idxfile);
+	fclose(fp);
+	idxfp = NULL;
+	free(line);
+	free(seen);
+
+	/* a name missing from the index might still be in the archive */
+	if (found < (size_t)argc) {
+		free(idxoff);
+		idxoff = NULL;
+		idxlen = 0;
+	}
+}
+
+static void
+resetext(void)
+{
+	free(ext.path);
+	free(ext.linkpath);
+	ext.path = ext.linkpath = NULL;
+	ext.size = -1;
+	ext.mtime.tv_nsec = -1;
+	paxlen = 0;
+}
+
+/* read and parse the records of an extended header */
+static void
+getext(struct header *h, off_t l)
+{
+	char *p, *k, *v, *q, *end;
+	size_t n, len;
+	long ns;
+	int i;
+
+	resetext();
+	memcpy(paxhdr, h, BLKSIZ);
+	if ((size_t)l + BLKSIZ + 1 > paxsiz) {
+		paxsiz = l + BLKSIZ + 1;
+		pax = erealloc(pax, paxsiz);
+	}
+	/* whole blocks, so they can be passed on as they are */
+	for (; paxlen < (size_t)l; paxlen += n * BLKSIZ) {
+		n = (l - paxlen + BLKSIZ - 1) / BLKSIZ;
+		if (!(p = getblks(&n)))
+			eprintf("unexpected end of archive\n");
+		memcpy(pax + paxlen, p, n * BLKSIZ);
+	}
+	pax[paxlen] = '\0';
+	paxlen = l;
+
+	for (p = pax, end = pax + paxlen; p < end; p += len) {
+		/* "len key=value\n" */
+		len = strtoul(p, &k, 10);
+		if (k == p || *k++ != ' ' || len > (size_t)(end - p) ||
+		    len < (size_t)(k - p) + 2 || p[len - 1] != '\n')
+			eprintf("malformed extended header\n");
+		if (!(v = memchr(k, '=', p + len - k)))
+			eprintf("malformed extended header\n");
+		n = v++ - k;
+		if (n == 4 && !memcmp(k, "path", 4)) {
+			free(ext.path);
+			ext.path = estrndup(v, p + len - 1 - v);
+		} else if (n == 8 && !memcmp(k, "linkpath", 8)) {
+			free(ext.linkpath);
+			ext.linkpath = estrndup(v, p + len - 1 - v);
+		} else if (n == 4 && !memcmp(k, "size", 4)) {
+			if ((ext.size = strtoll(v, &q, 10)) < 0 || *q != '\n')
+				eprintf("malformed extended header\n");
+		} else if (n == 5 && !memcmp(k, "mtime", 5)) {
+			ext.mtime.tv_sec = strtoll(v, &q, 10);
+			ns = 0;
+			if (*q == '.')
+				q++;
+			for (i = 0; i < 9; i++)
+				ns = ns * 10 + (*q >= '0' && *q <= '9' ? *q++ - '0' : 0);
+			ext.mtime.tv_nsec = ns;
+		}
+	}
+}
+
+static void xt(int, char *[], int);
+
+static void
+startjobs(void)
+{
+	int fds[2], i, j;
+
+	jobfd = ecalloc(njobs, sizeof(*jobfd));
+	jobpid = ecalloc(njobs, sizeof(*jobpid));
+	for (i = 0; i < njobs; i++) {
+		if (pipe(fds) < 0)
+			eprintf("pipe:");
+		switch ((jobpid[i] = fork())) {
+		case -1:
+			eprintf("fork:");
+		case 0:
+			/* a plain archive of regular files on the pipe */
+			for (j = 0; j < i; j++)
+				close(jobfd[j]);
+			close(fds[1]);
+			close(tarfd);
+			tarfd = fds[0];
+			filtermode = 0;
+			tarseek = 0;
+			idxfp = NULL;
+			vflag = 0;
+			njobs = 1;
+			xt(0, NULL, 'x');
+			exit(recurse_status);
+		}
+		close(fds[0]);
+		jobfd[i] = fds[1];
+	}
+	/* a job that failed has said why */
+	signal(SIGPIPE, SIG_IGN);
+}
+
+static void
+sendjob(const char *fname, const char *raw, long l)
+{
+	const unsigned char *s;
+	unsigned h = 5381;
+	size_t n;
+	char *p;
+	int fd;
+
+	/* the same name always goes to the same job, so a later
+	 * member still replaces an earlier one */
+	for (s = (const unsigned char *)fname; *s; s++)
+		h = h * 33 + *s;
+	fd = jobfd[h % njobs];
+
+	if (paxlen) {
+		ewrite(fd, paxhdr, BLKSIZ);
+		ewrite(fd, pax, (paxlen + BLKSIZ - 1) / BLKSIZ * BLKSIZ);
+	}
+	ewrite(fd, raw, BLKSIZ);
+	for (; l > 0; l -= n * BLKSIZ) {
+		n = (l + BLKSIZ - 1) / BLKSIZ;
+		if (!(p = getblks(&n)))
+			eprintf("unexpected end of archive\n");
+		ewrite(fd, p, n * BLKSIZ);
+	}
+}
+
+static void
+finishjobs(void)
+{
+	struct deferred *d;
+	int i, status;
+
+	for (i = 0; i < njobs; i++)
+		close(jobfd[i]);
+	for (i = 0; i < njobs; i++) {
+		if (waitpid(jobpid[i], &status, 0) < 0)
+			eprintf("waitpid:");
+		if (!WIFEXITED(status) || WEXITSTATUS(status))
+			recurse_status = 1;
+	}
+	free(jobfd);
+	free(jobpid);
+
+	/* now that their targets are there */
+	for (d = deferred; d < deferred + ndeferred; d++) {
+		ext.linkpath = d->linkpath;
+		ext.mtime = d->mtime;
+		unarchive(d->name, 0, d->b);
+		free(d->name);
+		resetext();
+	}
+	free(deferred);
+	deferred = NULL;
+	ndeferred = 0;
+}
+
 static void
 xt(int argc, char *argv[], int mode)
 {
-	char b[BLKSIZ], fname[256 + 1], *p;
+	char b[BLKSIZ], raw[BLKSIZ], fname[256 + 1], *name, *p;
 	struct timespec times[2];
 	struct header *h = (struct header *)b;
 	struct dirtime *dirtime;
-	long size;
+	struct deferred *d;
+	off_t size;
+	size_t one, next = 0;
 	int i, n;
 	int (*fn)(char *, ssize_t, char[BLKSIZ]) = (mode == 'x') ? unarchive : print;
 
-	while (eread(tarfd, b, BLKSIZ) > 0 && h->name[0]) {
+	if (idxfp)
+		readidx(argc, argv);
+
+	for (;; resetext()) {
+		if (idxoff) {
+			if (next == idxlen)
+				break;
+			seektar(idxoff[next++]);
+		}
+next:
+		if (!(one = 1, p = getblks(&one)) || !*p)
+			break;
+		memcpy(b, p, BLKSIZ);
+		memcpy(raw, p, BLKSIZ);
 		chktar(h);
 		sanitize(h), n = 0;
+		size = getoctal(h->size, sizeof(h->size));
+
+		/* an extended header applies to the member after it,
+		 * ignore global pax header craziness */
+		if (h->type == EXTENDED) {
+			getext((struct header *)raw, size);
+			goto next;
+		} else if (h->type == GLOBAL) {
+			skipblk(size);
+			goto next;
+		}
+		if (h->type == SPARSE)
+			getsparse(h);
 
-		/* small dance around non-null terminated fields */
-		if (h->prefix[0])
+		/* small dance around non-null terminated fields, old GNU
+		 * headers have no prefix */
+		if (h->prefix[0] && memcmp(h->version, " ", 2))
 			n = snprintf(fname, sizeof(fname), "%.*s/",
 			             (int)sizeof(h->prefix), h->prefix);
 		snprintf(fname + n, sizeof(fname) - n, "%.*s",
 		         (int)sizeof(h->name), h->name);
-
-		if ((size = strtol(h->size, &p, 8)) < 0 || *p != '\0')
-			eprintf("strtol %s: invalid number\n", h->size);
+		name = ext.path ? ext.path : fname;
+		if (ext.size >= 0)
+			size = ext.size;
 
 		if (argc) {
 			/* only extract the given files */
 			for (i = 0; i < argc; i++)
-				if (!strcmp(argv[i], fname))
+				if (!strcmp(argv[i], name))
 					break;
 			if (i == argc) {
+				if (idxoff)
+					eprintf("%s: index does not match archive\n", idxfile);
 				skipblk(size);
 				continue;
 			}
 		}
 
-		/* ignore global pax header craziness */
-		if (h->type == 'g' || h->type == 'x') {
+		if (mode == 'x' && njobs > 1 && (h->type == REG ||
+		    h->type == AREG || h->type == RESERVED)) {
+			sendjob(name, raw, size);
+		} else if (mode == 'x' && njobs > 1 && (h->type == HARDLINK ||
+		           h->type == SYMLINK)) {
+			deferred = ereallocarray(deferred, ndeferred + 1, sizeof(*deferred));
+			d = &deferred[ndeferred++];
+			d->name = estrdup(name);
+			d->linkpath = ext.linkpath;
+			d->mtime = ext.mtime;
+			ext.linkpath = NULL;
+			memcpy(d->b, b, BLKSIZ);
 			skipblk(size);
-			continue;
+		} else {
+			fn(name, size, b);
 		}
-
-		fn(fname, size, b);
 		if (vflag && mode != 't')
-			puts(fname);
+			puts(name);
 	}
+	resetext();
 
+	if (mode == 'x' && njobs > 1)
+		finishjobs();
 	if (mode == 'x' && !mflag) {
 		while ((dirtime = popdirtime())) {
-			times[0].tv_sec = times[1].tv_sec = dirtime->mtime;
-			times[0].tv_nsec = times[1].tv_nsec = 0;
+			times[0] = times[1] = dirtime->mtime;
 			if (utimensat(AT_FDCWD, dirtime->name, times, 0) < 0)
-				eprintf("utimensat %s:", fname);
+				eprintf("utimensat %s:", dirtime->name);
 			free(dirtime->name);
 		}
 		free(dirtimes);
@@ -493,10 +1425,10 @@ xt(int argc, char *argv[], int mode)
 static void
 usage(void)
 {
-	eprintf("usage: %s [-C dir] [-J | -Z | -a | -j | -z] -x [-m | -t] "
-	        "[-f file] [file ...]\n"
-	        "       %s [-C dir] [-J | -Z | -a | -j | -z] [-h] -c path ... "
-	        "[-f file]\n", argv0, argv0);
+	eprintf("usage: %s [-C dir] [-J | -Z | -a | -j | -z] [-b blocks] "
+	        "-x [-m | -t] [-n jobs] [-f file] [-I index] [file ...]\n"
+	        "       %s [-C dir] [-J | -Z | -a | -j | -z] [-b blocks] [-h] "
+	        "-c path ... [-f file] [-I index]\n", argv0, argv0);
 }
 
 int
@@ -514,15 +1446,24 @@ main(int argc, char *argv[])
 	case 't':
 		mode = ARGC();
 		break;
+	case 'b':
+		tarbufsiz = estrtonum(EARGF(usage()), 1, SSIZE_MAX / BLKSIZ) * BLKSIZ;
+		break;
 	case 'C':
 		dir = EARGF(usage());
 		break;
 	case 'f':
 		file = EARGF(usage());
 		break;
+	case 'I':
+		idxfile = EARGF(usage());
+		break;
 	case 'm':
 		mflag = 1;
 		break;
+	case 'n':
+		njobs = estrtonum(EARGF(usage()), 1, 256);
+		break;
 	case 'J':
 	case 'Z':
 	case 'a':
@@ -546,6 +1487,7 @@ main(int argc, char *argv[])
 	if (mode == 'c')
 		if (!argc)
 			usage();
+	tarbuf = emalloc(tarbufsiz);
 
 	switch (mode) {
 	case 'c':
@@ -559,14 +1501,25 @@ main(int argc, char *argv[])
 			tarinode = st.st_ino;
 			tardev = st.st_dev;
 		}
-
-		if (filtertool)
+		if (idxfile && !(idxfp = fopen(idxfile, "w")))
+			eprintf("fopen %s:", idxfile);
+
+		if (filtermode == 'z' && njobs > 1)
+			startzjobs();
+		else if (filtermode == 'z')
+			deflate_init(&gz);
+		else if (filtertool)
 			tarfd = comp(tarfd, filtertool, "-cf");
 
 		if (chdir(dir) < 0)
 			eprintf("chdir %s:", dir);
 		for (; *argv; argc--, argv++)
 			recurse(*argv, NULL, &r);
+		while (npending)
+			archivenext();
+		endarchive();
+		if (idxfp && fshut(idxfp, idxfile))
+			recurse_status = 1;
 		break;
 	case 't':
 	case 'x':
@@ -577,14 +1530,21 @@ main(int argc, char *argv[])
 				eprintf("open %s:", file);
 		}
 
-		if (filtertool) {
+		if (filtermode == 'z') {
+			inflate_init(&gunz, tarfd);
+		} else if (filtertool) {
 			fd = tarfd;
 			tarfd = decomp(tarfd, filtertool, "-cd");
 			close(fd);
 		}
+		tarseek = !filtermode && (tarstart = lseek(tarfd, 0, SEEK_CUR)) >= 0;
+		if (idxfile && argc && tarseek && !(idxfp = fopen(idxfile, "r")))
+			eprintf("fopen %s:", idxfile);
 
 		if (chdir(dir) < 0)
 			eprintf("chdir %s:", dir);
+		if (mode == 'x' && njobs > 1)
+			startjobs();
 		xt(argc, argv, mode);
 		break;
 	}